@@ -0,0 +1,676 @@
+#include "annealer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "parallel.h"
+
+// The number of random moves sampled for the initial temperature
+static constexpr size_t TEMPERATURE_SAMPLES = 64;
+
+// The number of moves between two adaptions of the temperature
+static constexpr uint64_t EPOCH_LENGTH = 32;
+
+// The acceptance rate the temperature aims at in the beginning and at the end of a run
+static constexpr double INITIAL_ACCEPTANCE = 0.5;
+static constexpr double FINAL_ACCEPTANCE = 0.001;
+
+// How much a state is penalized per chip base sticking out, relative to the area of the chip base
+static constexpr double OVERFLOW_PENALTY = 4;
+
+// The share of the running time wire_annealer may spend on flow problems
+static constexpr double EXACT_SHARE = 0.5;
+
+// The length of a round of tempering between two exchanges, in seconds, or in moves if the moves are limited
+static constexpr double ROUND_SECONDS = 0.05;
+static constexpr uint64_t ROUND_MOVES = 1024;
+
+sp_state::sp_state(const packing &pack, bool flips) :
+        _flips(flips)
+{
+    const rect_store &store = pack.get_rect_store();
+    orientation = store.orientation;
+    widths = store.width;
+    heights = store.height;
+
+    const pos chip_width = pack.get_chip_base().get_dimension(dimension::x);
+    std::vector<std::vector<size_t>> rows(1);
+    pos row_width = 0;
+    for (size_t i = 0; i < orientation.size(); ++i)
+    {
+        if (widths[i] < heights[i])
+        {
+            rotate(i);
+        }
+
+        if (row_width + widths[i] > chip_width && !rows.back().empty())
+        {
+            rows.emplace_back();
+            row_width = 0;
+        }
+        rows.back().push_back(i);
+        row_width += widths[i];
+    }
+
+    for (auto row = rows.rbegin(); row != rows.rend(); ++row)
+    {
+        for (size_t index : *row)
+        {
+            sp.positive_locus.push_back(index);
+        }
+    }
+    for (auto &row : rows)
+    {
+        for (size_t index : row)
+        {
+            sp.negative_locus.push_back(index);
+        }
+    }
+}
+
+void sp_state::rotate(size_t rect)
+{
+    orientation[rect] = (uint8_t) ((orientation[rect] & 4) | ((orientation[rect] + 1) & 3));
+    std::swap(widths[rect], heights[rect]);
+}
+
+void sp_state::flip(size_t rect)
+{
+    orientation[rect] ^= 4;
+}
+
+void sp_state::propose(std::mt19937_64 &random)
+{
+    const size_t num_rects = orientation.size();
+    std::uniform_int_distribution<size_t> any_rect(0, num_rects - 1);
+    std::uniform_int_distribution<size_t> any_other(1, num_rects - 1);
+    std::uniform_int_distribution<int> any_kind(0, 9);
+
+    // Only rotations and flips are possible with a single rectangle
+    const int kind = num_rects < 2 ? 8 + (int) (random() & 1) : any_kind(random);
+    _first = any_rect(random);
+    if (kind < 3)
+    {
+        _last_kind = move_kind::swap_positive;
+        _second = (_first + any_other(random)) % num_rects;
+        sp.positive_locus.swap(_first, _second);
+    }
+    else if (kind < 6)
+    {
+        _last_kind = move_kind::swap_both;
+        _second = (_first + any_other(random)) % num_rects;
+        sp.positive_locus.swap(_first, _second);
+        sp.negative_locus.swap(_first, _second);
+    }
+    else if (kind < 8)
+    {
+        _last_kind = kind == 6 ? move_kind::move_positive : move_kind::move_negative;
+        locus &target = kind == 6 ? sp.positive_locus : sp.negative_locus;
+        _second = target.position(_first);
+        target.move(_first, any_rect(random));
+    }
+    else if (kind == 9 && _flips)
+    {
+        _last_kind = move_kind::flip;
+        flip(_first);
+    }
+    else
+    {
+        _last_kind = move_kind::rotate;
+        rotate(_first);
+    }
+}
+
+void sp_state::undo()
+{
+    switch (_last_kind)
+    {
+        case move_kind::swap_positive:
+            sp.positive_locus.swap(_first, _second);
+            break;
+        case move_kind::swap_both:
+            sp.positive_locus.swap(_first, _second);
+            sp.negative_locus.swap(_first, _second);
+            break;
+        case move_kind::move_positive:
+            sp.positive_locus.move(_first, _second);
+            break;
+        case move_kind::move_negative:
+            sp.negative_locus.move(_first, _second);
+            break;
+        case move_kind::rotate:
+            // Three more quarter turns
+            rotate(_first);
+            rotate(_first);
+            rotate(_first);
+            break;
+        case move_kind::flip:
+            flip(_first);
+            break;
+    }
+}
+
+void sp_state::orient(packing &pack) const
+{
+    const rect_store &store = pack.get_rect_store();
+    for (size_t i = 0; i < orientation.size(); ++i)
+    {
+        if (store.orientation[i] != orientation[i])
+        {
+            pack.set_orientation((int) i, orientation[i]);
+        }
+    }
+}
+
+annealer::annealer(const packing &pack, const anneal_options &options, bool flips) :
+        _pack(pack),
+        _options(options),
+        _state(pack, flips),
+        _random(options.seed)
+{
+    // A quarter of the range, so adding an extent to a coordinate cannot overflow
+    const pos unbounded = std::numeric_limits<pos>::max() / 4;
+    const point &base = pack.get_chip_base().base;
+    _unbounded = rectangle(base, point(base.x + unbounded, base.y + unbounded, true));
+}
+
+double annealer::evaluate_overflow(sp_bounds &bounds)
+{
+    bounds = _state.sp.evaluate(_state.widths, _state.heights, _unbounded, _scratch);
+    if (!bounds.fits)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    const pos chip_width = _pack.get_chip_base().get_dimension(dimension::x);
+    const pos chip_height = _pack.get_chip_base().get_dimension(dimension::y);
+    return (double) std::max(0, bounds.width - chip_width) / std::max(1, chip_width)
+           + (double) std::max(0, bounds.height - chip_height) / std::max(1, chip_height);
+}
+
+double annealer::elapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+void annealer::record_best(double value)
+{
+    _best_value = value;
+    _found = true;
+    if (_incumbent != nullptr)
+    {
+        double incumbent = _incumbent->load(std::memory_order_relaxed);
+        while (value < incumbent && !_incumbent->compare_exchange_weak(incumbent, value, std::memory_order_relaxed))
+        {}
+    }
+}
+
+double annealer::get_incumbent() const
+{
+    double incumbent = _found ? _best_value : std::numeric_limits<double>::infinity();
+    if (_incumbent != nullptr)
+    {
+        incumbent = std::min(incumbent, _incumbent->load(std::memory_order_relaxed));
+    }
+    return incumbent;
+}
+
+void annealer::start(std::chrono::steady_clock::time_point start)
+{
+    _start = start;
+    _num_moves = 0;
+    _found = false;
+    _current = cost(std::numeric_limits<double>::infinity());
+}
+
+double annealer::sample_uphill()
+{
+    // With the current cost as threshold, an expensive objective only has to bound the uphill moves, which makes
+    // the temperature a little lower at worst
+    double uphill = 0;
+    size_t num_uphill = 0;
+    for (size_t i = 0; i < TEMPERATURE_SAMPLES && elapsed() < _options.time_limit; ++i)
+    {
+        _state.propose(_random);
+        const double sample = cost(_current);
+        if (sample > _current && sample < std::numeric_limits<double>::infinity())
+        {
+            uphill += sample - _current;
+            ++num_uphill;
+        }
+        _state.undo();
+    }
+    return num_uphill == 0 ? 0 : uphill / (double) num_uphill;
+}
+
+uint64_t annealer::walk(double temperature, uint64_t num_moves, double deadline)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    uint64_t accepted = 0;
+    for (uint64_t i = 0; i < num_moves && !finished() && elapsed() < deadline; ++i)
+    {
+        // The same as accepting if next <= current or unit < exp((current - next) / temperature)
+        const double threshold = _current - temperature * std::log(unit(_random));
+        _state.propose(_random);
+        const double next = cost(threshold);
+        if (next <= threshold)
+        {
+            _current = next;
+            ++accepted;
+        }
+        else
+        {
+            _state.undo();
+        }
+        ++_num_moves;
+    }
+    return accepted;
+}
+
+bool annealer::finished() const
+{
+    return (_options.max_moves != 0 && _num_moves >= _options.max_moves) || elapsed() >= _options.time_limit;
+}
+
+bool annealer::run()
+{
+    start(std::chrono::steady_clock::now());
+    if (_state.orientation.empty())
+    {
+        _seconds = elapsed();
+        return _found;
+    }
+
+    const double uphill = sample_uphill();
+    double temperature = uphill == 0 ? 1e-6 : uphill / std::log(1 / INITIAL_ACCEPTANCE);
+    while (!finished())
+    {
+        const uint64_t accepted = walk(temperature, EPOCH_LENGTH, _options.time_limit);
+
+        const double progress = _options.max_moves != 0 ? (double) _num_moves / (double) _options.max_moves
+                                                        : elapsed() / _options.time_limit;
+        const double target = INITIAL_ACCEPTANCE * std::pow(FINAL_ACCEPTANCE / INITIAL_ACCEPTANCE, progress);
+        temperature *= (double) accepted > target * EPOCH_LENGTH ? 0.9 : 1.1;
+    }
+
+    _seconds = elapsed();
+    return _found;
+}
+
+area_annealer::area_annealer(const packing &pack, const anneal_options &options) :
+        annealer(pack, options, false)
+{}
+
+double area_annealer::cost(double)
+{
+    sp_bounds bounds;
+    const double overflow = evaluate_overflow(bounds);
+    if (!bounds.fits)
+    {
+        return overflow;
+    }
+
+    const rectangle &chip_base = _pack.get_chip_base();
+
+    // The same area as packing::calculate_area, as floating point number so it cannot overflow
+    const double area = _state.orientation.empty() ? 0 : (double) (chip_base.base.x + bounds.width)
+                                                         * (chip_base.base.y + bounds.height);
+    if (overflow == 0 && (!_found || area < _best_value))
+    {
+        _best = _state;
+        record_best(area);
+    }
+
+    const double chip_area = std::max(1.0, (double) chip_base.get_max(dimension::x) * chip_base.get_max(dimension::y));
+    return area / chip_area + OVERFLOW_PENALTY * overflow;
+}
+
+void area_annealer::apply_best(packing &pack) const
+{
+    _best.orient(pack);
+
+    sp_scratch scratch;
+    _best.sp.evaluate(pack, scratch);
+    sequence_pair::place_evaluated(pack, scratch);
+}
+
+wire_annealer::wire_annealer(const packing &pack, const anneal_options &options) :
+        annealer(pack, options, true),
+        _placed(pack.get_rect_store())
+{
+    // Every net fits into the chip base
+    const csr_netlist &netlist = pack.get_netlist();
+    const rectangle &chip_base = pack.get_chip_base();
+    for (size_t i = 0; i < netlist.num_nets(); ++i)
+    {
+        _infeasible_cost += std::abs((double) netlist.net_weight(i))
+                            * ((double) chip_base.get_dimension(dimension::x) + chip_base.get_dimension(dimension::y));
+    }
+    _infeasible_cost += 1;
+}
+
+double wire_annealer::lower_bound() const
+{
+    const csr_netlist &netlist = _pack.get_netlist();
+    const rectangle &chip_base = _pack.get_chip_base();
+    const point chip_min = chip_base.base;
+    const point chip_max(chip_base.get_max(dimension::x), chip_base.get_max(dimension::y), true);
+    const size_t num_rects = _state.orientation.size();
+
+    double bound = 0;
+    for (size_t i = 0; i < netlist.num_nets(); ++i)
+    {
+        if (netlist.net_begin(i) == netlist.net_end(i))
+        {
+            continue;
+        }
+
+        // The largest lower end and the smallest upper end of the ranges of the pins
+        pos lowest_x = std::numeric_limits<pos>::min();
+        pos lowest_y = std::numeric_limits<pos>::min();
+        pos highest_x = std::numeric_limits<pos>::max();
+        pos highest_y = std::numeric_limits<pos>::max();
+        for (size_t k = netlist.net_begin(i); k < netlist.net_end(i); ++k)
+        {
+            const size_t rect = netlist.pin_rect(k);
+            pos min_x, min_y, max_x, max_y;
+            if (rect < num_rects)
+            {
+                const point offset = netlist.relative_position(k, _state.orientation[rect]);
+                min_x = chip_min.x + _scratch.coordinates[0][rect] + offset.x;
+                min_y = chip_min.y + _scratch.coordinates[1][rect] + offset.y;
+                max_x = chip_max.x - _scratch.tails[0][rect] - _state.widths[rect] + offset.x;
+                max_y = chip_max.y - _scratch.tails[1][rect] - _state.heights[rect] + offset.y;
+            }
+            else
+            {
+                const point offset = netlist.relative_position(k, 0);
+                min_x = max_x = chip_min.x + offset.x;
+                min_y = max_y = chip_min.y + offset.y;
+            }
+            lowest_x = std::max(lowest_x, min_x);
+            lowest_y = std::max(lowest_y, min_y);
+            highest_x = std::min(highest_x, max_x);
+            highest_y = std::min(highest_y, max_y);
+        }
+
+        bound += (double) netlist.net_weight(i) * (std::max(0, lowest_x - highest_x) + std::max(0, lowest_y - highest_y));
+    }
+    return bound;
+}
+
+double wire_annealer::cost(double threshold)
+{
+    sp_bounds bounds;
+    const double overflow = evaluate_overflow(bounds);
+    if (!bounds.fits)
+    {
+        return overflow;
+    }
+    if (overflow > 0)
+    {
+        return _infeasible_cost * (1 + OVERFLOW_PENALTY * overflow);
+    }
+
+    const point &chip_base = _pack.get_chip_base().base;
+    for (size_t i = 0; i < _state.orientation.size(); ++i)
+    {
+        _placed.x[i] = chip_base.x + _scratch.coordinates[0][i];
+        _placed.y[i] = chip_base.y + _scratch.coordinates[1][i];
+        _placed.orientation[i] = _state.orientation[i];
+        _placed.width[i] = _state.widths[i];
+        _placed.height[i] = _state.heights[i];
+    }
+    const double estimate = (double) _pack.get_netlist().compute_hpwl(_placed, chip_base, _hpwl_scratch);
+    if (estimate > threshold)
+    {
+        return estimate;
+    }
+
+    // Only an accepted state which may beat the best one is solved, and only while the flow problems have taken at
+    // most their share of the time so far
+    _state.sp.evaluate_tails(_state.widths, _state.heights, _scratch);
+    const double bound = lower_bound();
+    const double incumbent = get_incumbent();
+    const double average_ratio = _num_exact == 0 ? 0 : _ratio_sum / (double) _num_exact;
+    if (incumbent < std::numeric_limits<double>::infinity()
+        && (bound >= incumbent || estimate * average_ratio >= incumbent || _exact_seconds > EXACT_SHARE * elapsed()))
+    {
+        return estimate;
+    }
+
+    weight netlength = (weight) estimate;
+    if (estimate > bound)
+    {
+        const double start = elapsed();
+        netlength = _pack.compute_netlength_optimal(_state.sp, _placed);
+        _exact_seconds += elapsed() - start;
+        ++_num_exact;
+        _ratio_sum += netlength / estimate;
+    }
+    if (netlength != _invalid_cost && (!_found || netlength < _best_value))
+    {
+        _best = _state;
+        record_best(netlength);
+        if (_report)
+        {
+            _report(elapsed(), netlength);
+        }
+    }
+    return estimate;
+}
+
+weight wire_annealer::apply_best(packing &pack) const
+{
+    _best.orient(pack);
+    return pack.compute_netlength_optimal(_best.sp);
+}
+
+template<class chain_type>
+tempering<chain_type>::tempering(const packing &pack, const anneal_options &options, size_t num_chains) :
+        _options(options),
+        _incumbent(std::numeric_limits<double>::infinity()),
+        _random(options.seed)
+{
+    // The nets are loaded on first use, which must not happen on several threads
+    pack.get_netlist();
+
+    for (size_t k = 0; k < std::max<size_t>(num_chains, 1); ++k)
+    {
+        anneal_options chain_options = options;
+        chain_options.seed = options.seed + k;
+        _chains.emplace_back(new chain_type(pack, chain_options));
+        _chains.back()->_incumbent = &_incumbent;
+    }
+}
+
+template<class chain_type>
+void tempering<chain_type>::exchange(size_t first)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    for (size_t slot = first; slot + 1 < _ladder.size(); slot += 2)
+    {
+        const chain_type &colder = *_chains[_ladder[slot]];
+        const chain_type &hotter = *_chains[_ladder[slot + 1]];
+        const double exponent = (1 / _temperatures[slot] - 1 / _temperatures[slot + 1])
+                                * (colder._current - hotter._current);
+        ++_num_exchanges;
+        if (exponent >= 0 || unit(_random) < std::exp(exponent))
+        {
+            std::swap(_ladder[slot], _ladder[slot + 1]);
+            ++_num_accepted_exchanges;
+        }
+    }
+}
+
+template<class chain_type>
+bool tempering<chain_type>::run()
+{
+    const auto start = std::chrono::steady_clock::now();
+    _incumbent = std::numeric_limits<double>::infinity();
+    _num_exchanges = 0;
+    _num_accepted_exchanges = 0;
+
+    const auto elapsed = [&start]()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    const auto finished = [this]()
+    {
+        return std::all_of(_chains.begin(), _chains.end(),
+                           [](const std::unique_ptr<chain_type> &chain) { return chain->finished(); });
+    };
+
+    const size_t num_chains = _chains.size();
+    const uint64_t num_moves = _options.max_moves != 0 ? ROUND_MOVES : std::numeric_limits<uint64_t>::max();
+    std::vector<double> uphill(num_chains);
+    std::vector<double> targets(num_chains);
+    double deadline = 0;
+    double reported = std::numeric_limits<double>::infinity();
+    size_t round = 0;
+    bool done = false;
+    std::atomic<bool> failed(false);
+
+    // The ladder is set by the average of the samples of all chains
+    const auto prepare = [&]()
+    {
+        double uphill_sum = 0;
+        size_t num_samples = 0;
+        for (double sample : uphill)
+        {
+            if (sample > 0)
+            {
+                uphill_sum += sample;
+                ++num_samples;
+            }
+        }
+        const double hot = num_samples == 0 ? 1e-6
+                                            : uphill_sum / (double) num_samples / std::log(1 / INITIAL_ACCEPTANCE);
+        const double cold = hot * std::log(1 / INITIAL_ACCEPTANCE) / std::log(1 / FINAL_ACCEPTANCE);
+        _temperatures.resize(num_chains);
+        _ladder.resize(num_chains);
+        for (size_t slot = 0; slot < num_chains; ++slot)
+        {
+            const double share = num_chains == 1 ? 0 : (double) slot / (double) (num_chains - 1);
+            _temperatures[slot] = cold * std::pow(hot / cold, share);
+            targets[slot] = FINAL_ACCEPTANCE * std::pow(INITIAL_ACCEPTANCE / FINAL_ACCEPTANCE, share);
+            _ladder[slot] = slot;
+        }
+    };
+
+    // Every slot of the ladder keeps its thread for the whole run. The last thread to finish a round reports, exchanges
+    // and sets up the next round while the others wait at the barrier.
+    barrier sync(num_chains, [&]()
+    {
+        if (failed || _chains.front()->_state.orientation.empty())
+        {
+            done = true;
+            return;
+        }
+        if (round == 0)
+        {
+            prepare();
+        }
+        else
+        {
+            const double incumbent = _incumbent.load();
+            if (incumbent < reported && _report)
+            {
+                _report(elapsed(), incumbent);
+            }
+            reported = std::min(reported, incumbent);
+
+            exchange((round - 1) % 2);
+        }
+        ++round;
+        done = finished();
+        deadline = _options.max_moves != 0 ? _options.time_limit
+                                           : std::min(_options.time_limit, elapsed() + ROUND_SECONDS);
+    });
+
+    run_in_parallel(num_chains, [&](size_t slot)
+    {
+        std::exception_ptr error;
+        try
+        {
+            _chains[slot]->start(start);
+            if (!_chains[slot]->_state.orientation.empty())
+            {
+                uphill[slot] = _chains[slot]->sample_uphill();
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            failed = true;
+        }
+
+        for (;;)
+        {
+            try
+            {
+                sync.arrive_and_wait();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+                failed = true;
+            }
+            if (done)
+            {
+                break;
+            }
+            if (failed)
+            {
+                continue;
+            }
+
+            try
+            {
+                // Only this thread touches the temperature of the slot during the round
+                chain_type &chain = *_chains[_ladder[slot]];
+                uint64_t round_moves = 0;
+                while (round_moves < num_moves && !chain.finished() && chain.elapsed() < deadline)
+                {
+                    const uint64_t before = chain._num_moves;
+                    const uint64_t accepted = chain.walk(_temperatures[slot],
+                                                         std::min(EPOCH_LENGTH, num_moves - round_moves), deadline);
+                    const uint64_t epoch_moves = chain._num_moves - before;
+                    round_moves += epoch_moves;
+                    _temperatures[slot] *= (double) accepted > targets[slot] * (double) epoch_moves ? 0.9 : 1.1;
+                }
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+                failed = true;
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    });
+
+    _seconds = elapsed();
+    return _incumbent.load() < std::numeric_limits<double>::infinity();
+}
+
+template<class chain_type>
+const chain_type &tempering<chain_type>::get_best() const
+{
+    const chain_type *best = _chains.front().get();
+    for (auto &chain : _chains)
+    {
+        if (chain->_found && (!best->_found || chain->_best_value < best->_best_value))
+        {
+            best = chain.get();
+        }
+    }
+    return *best;
+}
+
+template class tempering<area_annealer>;
+template class tempering<wire_annealer>;
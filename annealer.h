@@ -0,0 +1,473 @@
+#ifndef ANNEALER_H
+#define ANNEALER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "common.h"
+#include "netlist.h"
+#include "packing.h"
+#include "rect_store.h"
+#include "sequence_pair.h"
+
+/**
+ * The parameters of a simulated annealing run.
+ */
+struct anneal_options
+{
+    // The wall clock budget in seconds
+    double time_limit = 10;
+
+    // If not 0, the temperature schedule follows the number of moves instead of the time and the run stops after
+    // this many moves. Together with the seed this makes a run reproducible as long as the time limit is not hit.
+    uint64_t max_moves = 0;
+
+    uint64_t seed = 1;
+};
+
+/**
+ * A sequence pair together with the orientations of the rectangles, the state a sequence pair search walks on. It
+ * proposes random moves and can undo the last one:
+ * - swapping two rectangles in the positive locus,
+ * - swapping two rectangles in both loci,
+ * - moving a rectangle to another position in one of the loci,
+ * - rotating a rectangle by 90 degrees,
+ * - flipping a rectangle, if enabled.
+ * The extents of the rectangles in their current orientation are kept up to date for sequence_pair::evaluate.
+ */
+class sp_state
+{
+public:
+    enum class move_kind
+    {
+        swap_positive,
+        swap_both,
+        move_positive,
+        move_negative,
+        rotate,
+        flip
+    };
+
+    sequence_pair sp;
+
+    // The orientation of every rectangle as in rect_store and its extents in that orientation
+    std::vector<uint8_t> orientation;
+    std::vector<pos> widths;
+    std::vector<pos> heights;
+
+private:
+    // The last move and what is needed to undo it
+    move_kind _last_kind = move_kind::rotate;
+    size_t _first = 0;
+    size_t _second = 0;
+
+    bool _flips = false;
+
+public:
+    sp_state() = default;
+
+    /**
+     * Starts with a shelf packing of the rectangles of a packing: they are laid down flat and put into rows of the
+     * width of the chip base in the order of their indices. Left of means earlier in both loci, below means later in
+     * the positive locus.
+     * @param pack The packing, its rectangles are not changed.
+     * @param flips Whether propose may flip rectangles.
+     */
+    sp_state(const packing &pack, bool flips);
+
+    /**
+     * Applies a random move.
+     * @param random The random number generator.
+     */
+    void propose(std::mt19937_64 &random);
+
+    /**
+     * Takes back the last move.
+     */
+    void undo();
+
+    /**
+     * Rotates and flips the rectangles of a packing into the orientations of this state. Placing them is up to the caller.
+     * @param pack The packing this state was created from.
+     */
+    void orient(packing &pack) const;
+
+private:
+    /**
+     * Turns a rectangle by 90 degrees counterclockwise and keeps it flipped or not.
+     */
+    void rotate(size_t rect);
+
+    /**
+     * Mirrors a rectangle, see rectangle::flip.
+     */
+    void flip(size_t rect);
+};
+
+template<class chain_type>
+class tempering;
+
+/**
+ * The simulated annealing on sp_state shared by the objectives. Derived classes evaluate the current state and keep
+ * the best one they have seen.
+ *
+ * The temperature is adapted after every epoch of moves: the acceptance rate of the epoch is compared to a target
+ * which decays geometrically from 1/2 to 1/1000 over the run, and the temperature is raised or lowered accordingly.
+ * The initial temperature accepts an average uphill move of a few random samples with probability 1/2.
+ */
+class annealer
+{
+    template<class chain_type>
+    friend class tempering;
+
+protected:
+    const packing &_pack;
+    anneal_options _options;
+
+    sp_state _state;
+    sp_scratch _scratch;
+    std::mt19937_64 _random;
+
+    // The chip base without upper bounds, so every state can be evaluated
+    rectangle _unbounded;
+
+    // The cost of the current state
+    double _current = 0;
+
+    // The objective value of the best valid state of this chain, and the best one of all chains of a tempering run
+    bool _found = false;
+    double _best_value = 0;
+    std::atomic<double> *_incumbent = nullptr;
+
+    uint64_t _num_moves = 0;
+    double _seconds = 0;
+    std::chrono::steady_clock::time_point _start;
+
+    /**
+     * Prepares a run on a packing.
+     * @param pack The packing, its rectangles are only read during the run.
+     * @param options The parameters.
+     * @param flips Whether the search may flip rectangles besides rotating them.
+     */
+    annealer(const packing &pack, const anneal_options &options, bool flips);
+
+    virtual ~annealer() = default;
+
+    /**
+     * Evaluates the current state and remembers it if it is the best valid one so far. A move is accepted if the cost
+     * of the new state is at most a threshold drawn by the Metropolis rule, so an objective which is expensive to
+     * evaluate may stop as soon as it knows the cost is above the threshold.
+     * @param threshold The largest cost which would be accepted.
+     * @return The cost to minimize, or any value above the threshold. Infinity if the state cannot be evaluated.
+     */
+    virtual double cost(double threshold) = 0;
+
+    /**
+     * Evaluates the current state against the unbounded chip base, the coordinates are in _scratch afterwards.
+     * @param bounds Gets the bounds of the placement.
+     * @return How far the placement sticks out of the chip base, the sum of both dimensions relative to the chip
+     * base, 0 if it fits.
+     */
+    double evaluate_overflow(sp_bounds &bounds);
+
+    /**
+     * Returns the seconds since the start of the run.
+     */
+    double elapsed() const;
+
+    /**
+     * Remembers the objective value of a new best state and offers it to the incumbent of a tempering run.
+     * @param value Less than the best value so far.
+     */
+    void record_best(double value);
+
+    /**
+     * Returns the least objective value a state has to beat to be of any use.
+     * @return The best value of this chain or of all chains of a tempering run, infinity if none was found.
+     */
+    double get_incumbent() const;
+
+    /**
+     * Starts a run: resets the counters and evaluates the initial state.
+     * @param start The time the run started.
+     */
+    void start(std::chrono::steady_clock::time_point start);
+
+    /**
+     * Evaluates a few random moves from the current state without making them.
+     * @return The average cost increase of the moves which increased it, 0 if none did.
+     */
+    double sample_uphill();
+
+    /**
+     * Makes moves at a fixed temperature.
+     * @param temperature The temperature of the Metropolis rule.
+     * @param num_moves The number of moves to make at most.
+     * @param deadline The number of seconds since the start after which no move is started.
+     * @return The number of accepted moves.
+     */
+    uint64_t walk(double temperature, uint64_t num_moves, double deadline);
+
+    /**
+     * Checks whether the run is over.
+     * @return True if the time limit or the limit of moves is reached.
+     */
+    bool finished() const;
+
+public:
+    /**
+     * Runs the annealing.
+     * @return True if a valid placement was found.
+     */
+    bool run();
+
+    /**
+     * Returns the number of moves of the last run.
+     */
+    uint64_t get_num_moves() const
+    {
+        return _num_moves;
+    }
+
+    /**
+     * Returns the running time of the last run in seconds.
+     */
+    double get_seconds() const
+    {
+        return _seconds;
+    }
+};
+
+/**
+ * Minimizes the area of the bounding rectangle (see packing::calculate_area) over sequence pairs and rotations. A
+ * state which does not fit into the chip base is not rejected, it is penalized by how far it sticks out, so the search
+ * can pass through them. Only states which fit are candidates for the result.
+ */
+class area_annealer : public annealer
+{
+private:
+    sp_state _best;
+
+    double cost(double threshold) override;
+
+public:
+    /**
+     * Prepares a run on a packing.
+     * @param pack The packing, its rectangles are only read during the run.
+     * @param options The parameters.
+     */
+    area_annealer(const packing &pack, const anneal_options &options);
+
+    /**
+     * Rotates and moves the rectangles of a packing to the best placement found.
+     * @param pack The packing given to the constructor.
+     */
+    void apply_best(packing &pack) const;
+
+    /**
+     * Returns the area of the best placement found.
+     * @return The value packing::calculate_area returns after apply_best.
+     */
+    double get_best_area() const
+    {
+        return _best_value;
+    }
+};
+
+/**
+ * Minimizes the netlength over sequence pairs, rotations and flips. The placement of a sequence pair with the least
+ * netlength is computed by packing::compute_netlength_optimal, which solves two min cost flow problems and is far too
+ * slow to run on every move. So the search walks on the netlength of the compact placement from evaluate, which only
+ * needs compute_hpwl, and solves the flow problems for an accepted state only if it may beat the best one: evaluate
+ * and evaluate_tails give the range of every rectangle in the placements of the sequence pair, and no placement can
+ * make a net shorter than the distance between the ranges of its pins. If this lower bound is not below the best
+ * netlength, or the compact netlength scaled by the average ratio seen so far is not, the state is skipped. The flow
+ * problems also get at most half of the time, so the walk goes on for large instances. If the compact placement
+ * reaches the bound it is optimal and no flow is needed.
+ *
+ * A state which does not fit into the chip base has no placement. It costs more than any state which fits, the more
+ * it sticks out the more, so the search can start from an infeasible shelf packing.
+ */
+class wire_annealer : public annealer
+{
+private:
+    // The compact placement of the current state, the flow problems write their optimal placement into it
+    rect_store _placed;
+
+    csr_netlist::scratch _hpwl_scratch;
+
+    // Bounds the netlength of every state which fits
+    double _infeasible_cost = 0;
+
+    sp_state _best;
+
+    // For the states solved so far: the number, the sum of the ratios of exact value to estimate and the time taken
+    uint64_t _num_exact = 0;
+    double _ratio_sum = 0;
+    double _exact_seconds = 0;
+
+    std::function<void(double, weight)> _report;
+
+    double cost(double threshold) override;
+
+    /**
+     * Computes the lower bound of the netlength of the current state, evaluate and evaluate_tails have to be called
+     * first.
+     */
+    double lower_bound() const;
+
+public:
+    /**
+     * Prepares a run on a packing.
+     * @param pack The packing, its rectangles are only read during the run.
+     * @param options The parameters.
+     */
+    wire_annealer(const packing &pack, const anneal_options &options);
+
+    /**
+     * Sets a function which is called with the seconds since the start and the netlength whenever a better placement
+     * was found.
+     */
+    void on_improvement(const std::function<void(double, weight)> &report)
+    {
+        _report = report;
+    }
+
+    /**
+     * Rotates, flips and moves the rectangles of a packing to the best placement found.
+     * @param pack The packing given to the constructor.
+     * @return Its netlength.
+     */
+    weight apply_best(packing &pack) const;
+
+    /**
+     * Returns the netlength of the best placement found.
+     * @return _invalid_cost if none was found.
+     */
+    weight get_best_netlength() const
+    {
+        return _found ? (weight) _best_value : _invalid_cost;
+    }
+
+    /**
+     * Returns the number of flow problems solved in the last run, for both dimensions together one.
+     */
+    uint64_t get_num_exact() const
+    {
+        return _num_exact;
+    }
+};
+
+/**
+ * Parallel tempering over sequence pairs: a ladder of chains of area_annealer or wire_annealer, each run by a thread of
+ * its own at a temperature of its own. Instead of cooling down, every temperature is adapted after every epoch of moves
+ * like in annealer::run, towards an acceptance rate of 1/2 for the hottest chain, 1/1000 for the coldest one and
+ * geometric in between. After every round of moves, neighbouring chains try to exchange their states by the Metropolis
+ * rule on both temperatures, so good states found by the hot chains drift down to the cold ones. Instead of the states,
+ * the temperatures are exchanged, which is the same.
+ *
+ * The chains only read the packing and its nets, every chain has its own state and scratch space. They share the best
+ * objective value found so far through an atomic, so a wire_annealer skips flow problems which cannot beat any chain.
+ * @tparam chain_type area_annealer or wire_annealer.
+ */
+template<class chain_type>
+class tempering
+{
+private:
+    anneal_options _options;
+    std::vector<std::unique_ptr<chain_type>> _chains;
+
+    // The temperatures from cold to hot and the chain which runs at every one of them
+    std::vector<double> _temperatures;
+    std::vector<size_t> _ladder;
+
+    std::atomic<double> _incumbent;
+    std::mt19937_64 _random;
+
+    uint64_t _num_exchanges = 0;
+    uint64_t _num_accepted_exchanges = 0;
+    double _seconds = 0;
+
+    std::function<void(double, double)> _report;
+
+    /**
+     * Tries to exchange the states of neighbouring chains.
+     * @param first The lower of the temperatures of the first pair, every other pair is tried from there.
+     */
+    void exchange(size_t first);
+
+public:
+    /**
+     * Prepares a run on a packing.
+     * @param pack The packing, its rectangles and nets are only read during the run, by all threads.
+     * @param options The parameters. The time limit and the limit of moves hold for every chain, chain k gets
+     * seed + k.
+     * @param num_chains The number of chains and threads, at least 1.
+     */
+    tempering(const packing &pack, const anneal_options &options, size_t num_chains);
+
+    /**
+     * Sets a function which is called with the seconds since the start and the objective value whenever a chain found
+     * a better placement. It is called between the rounds on the calling thread.
+     */
+    void on_improvement(const std::function<void(double, double)> &report)
+    {
+        _report = report;
+    }
+
+    /**
+     * Runs all chains.
+     * @return True if a chain found a valid placement.
+     */
+    bool run();
+
+    /**
+     * Returns the chain which found the best placement, to apply it.
+     */
+    const chain_type &get_best() const;
+
+    /**
+     * Returns the number of chains.
+     */
+    size_t get_num_chains() const
+    {
+        return _chains.size();
+    }
+
+    /**
+     * Returns the number of moves of a chain in the last run.
+     * @param chain The index of the chain.
+     */
+    uint64_t get_num_moves(size_t chain) const
+    {
+        return _chains[chain]->get_num_moves();
+    }
+
+    /**
+     * Returns the number of tried and the number of accepted exchanges of the last run.
+     */
+    uint64_t get_num_exchanges() const
+    {
+        return _num_exchanges;
+    }
+
+    uint64_t get_num_accepted_exchanges() const
+    {
+        return _num_accepted_exchanges;
+    }
+
+    /**
+     * Returns the running time of the last run in seconds.
+     */
+    double get_seconds() const
+    {
+        return _seconds;
+    }
+};
+
+#endif // ANNEALER_H
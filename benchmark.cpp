@@ -0,0 +1,1079 @@
+/*
+ * Small benchmarks for the performance critical parts. Call it with the name of a benchmark followed by the files it
+ * should run on, e.g. benchmark.out read Instances/inst9 Instances/pack_inst_13
+ */
+#include <chrono>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "packing.h"
+#include "annealer.h"
+#include "netlength_tracker.h"
+#include "placement_iterator.h"
+#include "branch_and_bound.h"
+#include "solution_writer.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ * Runs the function repeatedly and returns the best running time in milliseconds.
+ */
+static double time_best_of(size_t repetitions, const std::function<void()> &function)
+{
+    double best = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < repetitions; ++i)
+    {
+        auto start = bench_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> elapsed = bench_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/**
+ * Compares the stream based instance reader with the mapped one. Binary files can only be read by the mapped reader,
+ * for them the speedup is given relative to the stream reader on the text file of the same name without ".bin".
+ */
+static void bench_read(const std::vector<std::string> &files)
+{
+    std::cout << std::setw(30) << std::left << "instance" << std::right
+              << std::setw(12) << "stream [ms]" << std::setw(12) << "mapped [ms]" << std::setw(10) << "speedup"
+              << std::endl;
+
+    const std::string binary_suffix = ".bin";
+
+    for (auto &filename : files)
+    {
+        bool binary;
+        {
+            mapped_file file(filename);
+            binary = is_binary_file(file.begin(), file.end());
+        }
+
+        std::string text_filename = filename;
+        if (binary)
+        {
+            if (filename.size() <= binary_suffix.size()
+                || filename.compare(filename.size() - binary_suffix.size(), binary_suffix.size(), binary_suffix) != 0)
+            {
+                throw std::runtime_error("Binary file " + filename + " has to end with " + binary_suffix);
+            }
+            text_filename = filename.substr(0, filename.size() - binary_suffix.size());
+        }
+
+        size_t stream_rects = 0, mapped_rects = 0, stream_nets = 0, mapped_nets = 0;
+
+        double stream_time = time_best_of(5, [&]()
+        {
+            packing pack;
+            pack.read_inst_from_stream(text_filename);
+            stream_rects = pack.get_num_rects();
+            stream_nets = pack.get_num_nets();
+        });
+
+        double mapped_time = time_best_of(5, [&]()
+        {
+            packing pack;
+            pack.read_inst_from(filename);
+            mapped_rects = pack.get_num_rects();
+            mapped_nets = pack.get_num_nets();
+        });
+
+        if (stream_rects != mapped_rects || stream_nets != mapped_nets)
+        {
+            throw std::runtime_error("Readers disagree on " + filename);
+        }
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << stream_time << std::setw(12) << mapped_time
+                  << std::setw(9) << stream_time / mapped_time << "x" << std::endl;
+    }
+}
+
+/**
+ * Measures how parsing of text instances scales with the number of threads.
+ */
+static void bench_read_threads(const std::vector<std::string> &files)
+{
+    const std::vector<unsigned> thread_counts = {1, 2, 4, 8};
+
+    std::cout << std::setw(30) << std::left << "instance" << std::right;
+    for (auto num_threads : thread_counts)
+    {
+        std::cout << std::setw(10) << num_threads << " thr";
+    }
+    std::cout << "   [ms]" << std::endl;
+
+    for (auto &filename : files)
+    {
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(2);
+        for (auto num_threads : thread_counts)
+        {
+            std::cout << std::setw(14) << time_best_of(5, [&]()
+            {
+                packing pack;
+                pack.read_inst_from(filename, num_threads);
+            });
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Compares writing solutions with operator<< and with the solution_writer. The files are written to /tmp.
+ */
+static void bench_write(const std::vector<std::string> &files)
+{
+    std::cout << std::setw(30) << std::left << "solution" << std::right
+              << std::setw(12) << "stream [ms]" << std::setw(12) << "writer [ms]" << std::setw(10) << "speedup"
+              << std::endl;
+
+    const std::string output_file = "/tmp/rechteckspackung_bench.out";
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_sol_from(filename);
+
+        double stream_time = time_best_of(5, [&]()
+        {
+            std::ofstream out(output_file);
+            out << pack;
+        });
+
+        double writer_time = time_best_of(5, [&]()
+        {
+            solution_writer writer(output_file);
+            writer.write(pack);
+        });
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << stream_time << std::setw(12) << writer_time
+                  << std::setw(9) << stream_time / writer_time << "x" << std::endl;
+    }
+}
+
+/**
+ * Checks whether two placed rectangles have a common inner point, which is what the overlap checks of packing look
+ * for. Unlike rectangle::intersects, an empty rectangle never intersects anything.
+ */
+static bool share_inner_point(const rectangle &first, const rectangle &second)
+{
+    for (dimension dim : all_dimensions)
+    {
+        if (first.get_pos(dim) >= second.get_max(dim) || second.get_pos(dim) >= first.get_max(dim)
+            || first.get_pos(dim) == first.get_max(dim) || second.get_pos(dim) == second.get_max(dim))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checks that a certificate of an invalid packing names two different rectangles which really intersect.
+ */
+static bool is_real_overlap(const packing &pack, const certificate &cert)
+{
+    return cert.first != cert.second && share_inner_point(pack.get_rect(cert.first), pack.get_rect(cert.second));
+}
+
+/**
+ * Compares the validity check with the reference implementation and measures it with different numbers of threads.
+ * Both checks have to agree on the validity, the pair column tells whether they found the same intersecting pair. The
+ * reference counts an empty rectangle inside another one as an intersection, so solutions with empty rectangles are
+ * only timed and the pair column says "empty".
+ */
+static void bench_valid(const std::vector<std::string> &files)
+{
+    const std::vector<unsigned> thread_counts = {1, 2, 4, 8};
+
+    std::cout << std::setw(30) << std::left << "solution" << std::right << std::setw(8) << "valid"
+              << std::setw(8) << "pair" << std::setw(14) << "reference";
+    for (auto num_threads : thread_counts)
+    {
+        std::cout << std::setw(10) << num_threads << " thr";
+    }
+    std::cout << "   [ms]" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_sol_from(filename);
+
+        bool has_empty = false;
+        for (size_t i = 0; i < pack.get_num_rects(); ++i)
+        {
+            const rectangle &rect = pack.get_rect((int) i);
+            has_empty |= rect.get_dimension(dimension::x) == 0 || rect.get_dimension(dimension::y) == 0;
+        }
+
+        const certificate cert = pack.is_valid();
+        const certificate reference = has_empty ? cert : pack.is_valid_reference();
+        if (cert.valid != reference.valid)
+        {
+            throw std::runtime_error("Validity check disagrees with the reference on " + filename);
+        }
+        if (!cert.valid && (!is_real_overlap(pack, cert) || !is_real_overlap(pack, reference)))
+        {
+            throw std::runtime_error("Validity check reports rectangles which do not intersect on " + filename);
+        }
+
+        const bool same_pair = (cert.first == reference.first && cert.second == reference.second)
+                               || (cert.first == reference.second && cert.second == reference.first);
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << (cert.valid ? "yes" : "no")
+                  << std::setw(8) << (has_empty ? "empty" : cert.valid ? "-" : same_pair ? "same" : "other")
+                  << std::setw(14) << time_best_of(5, [&]()
+                  {
+                      pack.is_valid_reference();
+                  });
+
+        for (auto num_threads : thread_counts)
+        {
+            // The strips may find another pair than the reference, but it has to be a real one
+            const certificate parallel = pack.is_valid(num_threads);
+            if (parallel.valid != reference.valid || (!parallel.valid && !is_real_overlap(pack, parallel)))
+            {
+                throw std::runtime_error("Parallel validity check disagrees with the reference on " + filename);
+            }
+
+            std::cout << std::setw(14) << time_best_of(5, [&]()
+            {
+                pack.is_valid(num_threads);
+            });
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Collects the intersecting pairs of a packing by comparing all pairs of rectangles, with the smaller index first.
+ */
+static std::vector<std::pair<int, int>> brute_force_overlaps(const packing &pack)
+{
+    std::vector<std::pair<int, int>> pairs;
+    const int n = (int) pack.get_num_rects();
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = i + 1; j < n; ++j)
+        {
+            if (share_inner_point(pack.get_rect(i), pack.get_rect(j)))
+            {
+                pairs.emplace_back(i, j);
+            }
+        }
+    }
+    return pairs;
+}
+
+/**
+ * Measures the enumeration of all intersecting pairs. On solutions with few enough rectangles, the pairs are compared
+ * with the ones found by comparing all pairs.
+ */
+static void bench_overlaps(const std::vector<std::string> &files)
+{
+    // Larger solutions take too long to check by brute force
+    const size_t max_checked_rects = 20000;
+
+    std::cout << std::setw(30) << std::left << "solution" << std::right << std::setw(12) << "rects"
+              << std::setw(12) << "pairs" << std::setw(12) << "[ms]" << std::setw(10) << "checked" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_sol_from(filename);
+
+        std::vector<std::pair<int, int>> reported;
+        const double time = time_best_of(5, [&]()
+        {
+            reported.clear();
+            pack.report_overlaps([&reported](const certificate &cert)
+            {
+                reported.emplace_back(std::min(cert.first, cert.second), std::max(cert.first, cert.second));
+            });
+        });
+
+        const bool checked = pack.get_num_rects() <= max_checked_rects;
+        if (checked)
+        {
+            std::sort(reported.begin(), reported.end());
+            if (reported != brute_force_overlaps(pack))
+            {
+                throw std::runtime_error("report_overlaps finds other pairs than the brute force on " + filename);
+            }
+        }
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << pack.get_num_rects() << std::setw(12) << reported.size() << std::setw(12)
+                  << time << std::setw(10) << (checked ? "yes" : "no") << std::endl;
+    }
+}
+
+/**
+ * Compares a full validity check with checking a single moved rectangle against the grid index.
+ */
+static void bench_grid(const std::vector<std::string> &files)
+{
+    std::cout << std::setw(30) << std::left << "solution" << std::right << std::setw(12) << "rects"
+              << std::setw(12) << "build" << std::setw(12) << "is_valid" << std::setw(12) << "per move"
+              << std::setw(12) << "illegal" << "   [ms]" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_sol_from(filename);
+        const size_t n = pack.get_num_rects();
+        if (n == 0)
+        {
+            continue;
+        }
+
+        const double build_time = time_best_of(5, [&]()
+        {
+            pack.build_grid_index();
+        });
+        const double valid_time = time_best_of(5, [&]()
+        {
+            pack.is_valid();
+        });
+
+        // Move every rectangle by one unit, check it and move it back
+        size_t illegal_moves = 0;
+        const double move_time = time_best_of(5, [&]()
+        {
+            illegal_moves = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const point old_base = pack.get_rect((int) i).base;
+                pack.move_rect((int) i, point(old_base.x + 1, old_base.y, true));
+                illegal_moves += pack.overlaps_any((int) i);
+                pack.move_rect((int) i, old_base);
+            }
+        }) / n;
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(4)
+                  << std::setw(12) << n << std::setw(12) << build_time << std::setw(12) << valid_time
+                  << std::setw(12) << move_time << std::setw(12) << illegal_moves << std::endl;
+    }
+}
+
+/**
+ * Builds a sequence pair for a shelf packing: the rectangles are laid down flat and put into rows of the width of the
+ * chip in the order of their indices. Left of means earlier in both loci, below means later in the positive locus.
+ */
+static sequence_pair shelf_sequence_pair(packing &pack)
+{
+    const pos chip_width = pack.get_chip_base().get_dimension(dimension::x);
+    std::vector<std::vector<size_t>> rows(1);
+    pos row_width = 0;
+
+    for (size_t i = 0; i < pack.get_num_rects(); ++i)
+    {
+        const rectangle &rect = pack.get_rect((int) i);
+        if (rect.get_dimension(dimension::x) < rect.get_dimension(dimension::y))
+        {
+            pack.rotate_rect((int) i, rotation::rotated_90);
+        }
+
+        const pos width = rect.get_dimension(dimension::x);
+        if (row_width + width > chip_width && !rows.back().empty())
+        {
+            rows.emplace_back();
+            row_width = 0;
+        }
+        rows.back().push_back(i);
+        row_width += width;
+    }
+
+    sequence_pair sp;
+    for (auto row = rows.rbegin(); row != rows.rend(); ++row)
+    {
+        for (size_t index : *row)
+        {
+            sp.positive_locus.push_back(index);
+        }
+    }
+    for (auto &row : rows)
+    {
+        for (size_t index : row)
+        {
+            sp.negative_locus.push_back(index);
+        }
+    }
+    return sp;
+}
+
+/**
+ * Compares to_sequence_pair with the reference implementation on solutions and checks that both give the same loci.
+ */
+static void bench_to_sp(const std::vector<std::string> &files)
+{
+    std::cout << std::setw(30) << std::left << "solution" << std::right << std::setw(10) << "rects"
+              << std::setw(16) << "reference [ms]" << std::setw(12) << "flat [ms]" << std::setw(10) << "speedup"
+              << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_sol_from(filename);
+        if (!pack.is_valid().valid)
+        {
+            std::cout << std::setw(30) << std::left << filename << " is not valid, skipped" << std::endl;
+            continue;
+        }
+
+        sequence_pair reference, flat;
+        const double reference_time = time_best_of(3, [&]()
+        {
+            reference = pack.to_sequence_pair_reference();
+        });
+        const double flat_time = time_best_of(3, [&]()
+        {
+            flat = pack.to_sequence_pair();
+        });
+
+        if (!std::equal(reference.positive_locus.begin(), reference.positive_locus.end(),
+                        flat.positive_locus.begin())
+            || !std::equal(reference.negative_locus.begin(), reference.negative_locus.end(),
+                           flat.negative_locus.begin()))
+        {
+            std::cout << filename << ": the sequence pairs differ" << std::endl;
+        }
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::setw(10) << pack.get_num_rects()
+                  << std::fixed << std::setprecision(3) << std::setw(16) << reference_time << std::setw(12)
+                  << flat_time << std::setprecision(2) << std::setw(9) << reference_time / flat_time << "x"
+                  << std::endl;
+    }
+}
+
+/**
+ * Measures the kernels which are called for every candidate of an optimization run.
+ */
+static void bench_kernels(const std::vector<std::string> &files)
+{
+    std::cout << std::setw(30) << std::left << "instance" << std::right << std::setw(12) << "apply_to"
+              << std::setw(12) << "area" << std::setw(12) << "netlength" << std::setw(12) << "is_valid"
+              << "   [ms]" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_inst_from(filename);
+        pack.get_num_nets();
+        const sequence_pair sp = shelf_sequence_pair(pack);
+        if (!sp.apply_to(pack))
+        {
+            std::cout << filename << ": the shelf packing does not fit, the numbers are for a partial placement"
+                      << std::endl;
+        }
+
+        const double apply_time = time_best_of(5, [&]()
+        {
+            sp.apply_to(pack);
+        });
+        const double area_time = time_best_of(5, [&]()
+        {
+            pack.calculate_area();
+        });
+        const double netlength_time = time_best_of(5, [&]()
+        {
+            pack.compute_netlength();
+        });
+        const double valid_time = time_best_of(5, [&]()
+        {
+            pack.is_valid();
+        });
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << apply_time << std::setw(12) << area_time << std::setw(12) << netlength_time
+                  << std::setw(12) << valid_time << std::endl;
+    }
+}
+
+/**
+ * Compares compute_netlength with a straightforward evaluation, which computes the absolute position of every pin
+ * through its rectangle. The rectangles are placed as a shelf packing, so the nets span realistic distances.
+ */
+static void bench_netlength(const std::vector<std::string> &files)
+{
+    std::cout << std::setw(30) << std::left << "instance" << std::right << std::setw(10) << "pins"
+              << std::setw(12) << "simple [ms]" << std::setw(12) << "csr [ms]" << std::setw(10) << "speedup"
+              << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_inst_from(filename);
+        shelf_sequence_pair(pack).apply_to(pack);
+
+        size_t num_pins = 0;
+        int64_t simple_value = 0;
+        const double simple_time = time_best_of(5, [&]()
+        {
+            num_pins = 0;
+            simple_value = 0;
+            for (size_t i = 0; i < pack.get_num_nets(); ++i)
+            {
+                const net &n = pack.get_net(i);
+                bounding_box box;
+                for (auto &p : n.pin_list)
+                {
+                    box.add_point(pack.get_rect(p.index).get_absolute_pin_position(p));
+                }
+                if (!n.pin_list.empty())
+                {
+                    simple_value += (int64_t) n.net_weight * box.half_circumference();
+                }
+                num_pins += n.pin_list.size();
+            }
+        });
+
+        weight csr_value = 0;
+        const double csr_time = time_best_of(5, [&]()
+        {
+            csr_value = pack.compute_netlength();
+        });
+
+        if (csr_value != simple_value)
+        {
+            std::cout << filename << ": the netlengths differ, " << simple_value << " != " << csr_value << std::endl;
+        }
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::setw(10) << num_pins
+                  << std::fixed << std::setprecision(3) << std::setw(12) << simple_time << std::setw(12) << csr_time
+                  << std::setprecision(2) << std::setw(10) << simple_time / csr_time << std::endl;
+    }
+}
+
+/**
+ * Checks that a placement keeps the relations of a sequence pair as sequence_pair::place_dimension reads them: a
+ * rectangle before another one in both loci lies left of it, one after it in the positive locus and before it in the
+ * negative locus lies below it.
+ */
+static bool respects_sequence_pair(const packing &pack, const sequence_pair &sp)
+{
+    for (size_t i = 0; i < pack.get_num_rects(); ++i)
+    {
+        const rectangle &first = pack.get_rect((int) i);
+        for (size_t j = 0; j < pack.get_num_rects(); ++j)
+        {
+            if (i == j || !sp.negative_locus.before(i, j))
+            {
+                continue;
+            }
+            const dimension dim = sp.positive_locus.before(i, j) ? dimension::x : dimension::y;
+            if (first.get_max(dim) > pack.get_rect((int) j).get_pos(dim))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Compares compute_netlength_optimal with compute_netlength: the value of the flow has to be the netlength of the
+ * placement it produces, at most the netlength of the compact placement of the same sequence pair, and the placement
+ * has to be valid and keep the sequence pair. The sequence pairs come from short area annealing runs with several
+ * seeds, so they fit into the chip base.
+ */
+static void bench_flow(const std::vector<std::string> &files)
+{
+    const uint64_t num_runs = 5;
+    std::cout << std::setw(30) << std::left << "instance" << std::right << std::setw(10) << "rects"
+              << std::setw(10) << "nets" << std::setw(8) << "fits" << std::setw(12) << "flow [ms]"
+              << std::setw(12) << "mismatches" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_inst_from(filename);
+
+        size_t num_fits = 0;
+        size_t num_mismatches = 0;
+        double flow_time = 0;
+        for (uint64_t seed = 1; seed <= num_runs; ++seed)
+        {
+            anneal_options options;
+            options.max_moves = 20000;
+            options.seed = seed;
+            area_annealer annealer(pack, options);
+            if (!annealer.run())
+            {
+                continue;
+            }
+            ++num_fits;
+
+            // to_sequence_pair reads the loci the other way round than place_dimension, reversing both fixes that
+            annealer.apply_best(pack);
+            const sequence_pair found = pack.to_sequence_pair();
+            sequence_pair sp;
+            for (auto it = found.positive_locus.rbegin(); it != found.positive_locus.rend(); ++it)
+            {
+                sp.positive_locus.push_back(*it);
+            }
+            for (auto it = found.negative_locus.rbegin(); it != found.negative_locus.rend(); ++it)
+            {
+                sp.negative_locus.push_back(*it);
+            }
+            sp.apply_to(pack);
+            const weight compact = pack.compute_netlength();
+
+            weight optimal = 0;
+            flow_time += time_best_of(1, [&]()
+            {
+                optimal = pack.compute_netlength_optimal(sp);
+            });
+
+            const weight placed = pack.compute_netlength();
+            if (optimal != placed || optimal > compact)
+            {
+                std::cout << filename << ": the flow value is " << optimal << ", the netlength of its placement "
+                          << placed << " and the one of the compact placement " << compact << std::endl;
+                ++num_mismatches;
+            }
+            else if (!pack.is_valid().valid || !respects_sequence_pair(pack, sp))
+            {
+                std::cout << filename << ": the placement of the flow is not valid or breaks the sequence pair"
+                          << std::endl;
+                ++num_mismatches;
+            }
+        }
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::setw(10) << pack.get_num_rects()
+                  << std::setw(10) << pack.get_num_nets() << std::setw(8) << num_fits << std::fixed
+                  << std::setprecision(3) << std::setw(12) << flow_time / (double) std::max<size_t>(num_fits, 1)
+                  << std::setw(12) << num_mismatches << std::endl;
+    }
+}
+
+/**
+ * Measures how compute_netlength scales with the number of threads, the results have to be the same for all counts.
+ */
+static void bench_netlength_threads(const std::vector<std::string> &files)
+{
+    const std::vector<unsigned> thread_counts = {1, 2, 4, 8};
+
+    std::cout << std::setw(30) << std::left << "instance" << std::right;
+    for (auto num_threads : thread_counts)
+    {
+        std::cout << std::setw(10) << num_threads << " thr";
+    }
+    std::cout << "   [ms]" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_inst_from(filename);
+        shelf_sequence_pair(pack).apply_to(pack);
+        const weight expected = pack.compute_netlength();
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(3);
+        for (auto num_threads : thread_counts)
+        {
+            pack.set_num_threads(num_threads);
+            weight value = 0;
+            std::cout << std::setw(14) << time_best_of(20, [&]()
+            {
+                value = pack.compute_netlength();
+            });
+            if (value != expected)
+            {
+                std::cout << " (differs: " << value << " != " << expected << ")";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * Moves single rectangles back and forth and compares updating a netlength_tracker with recomputing the netlength.
+ */
+static void bench_incremental(const std::vector<std::string> &files)
+{
+    const size_t num_moves = 10000;
+    std::cout << std::setw(30) << std::left << "instance" << std::right << std::setw(14) << "full [us]"
+              << std::setw(14) << "tracker [us]" << std::setw(10) << "speedup" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing pack;
+        pack.read_inst_from(filename);
+        shelf_sequence_pair(pack).apply_to(pack);
+        netlength_tracker tracker(pack);
+
+        std::mt19937 generator(42);
+        std::vector<size_t> rects(num_moves);
+        for (auto &index : rects)
+        {
+            index = generator() % pack.get_num_rects();
+        }
+
+        // Every move is rejected and undone, so both variants see the same packings
+        auto move = [&](size_t index, pos distance)
+        {
+            const rectangle &rect = pack.get_rect((int) index);
+            pack.move_rect((int) index, point(rect.base.x + distance, rect.base.y, true));
+        };
+
+        weight checksum = 0;
+        const double full_time = time_best_of(3, [&]()
+        {
+            for (size_t index : rects)
+            {
+                move(index, 7);
+                checksum += pack.compute_netlength();
+                move(index, -7);
+            }
+        });
+
+        int64_t tracker_checksum = 0;
+        const double tracker_time = time_best_of(3, [&]()
+        {
+            for (size_t index : rects)
+            {
+                tracker.begin();
+                move(index, 7);
+                tracker.update(index);
+                tracker_checksum += tracker.get_netlength();
+                move(index, -7);
+                tracker.rollback();
+            }
+        });
+
+        if (checksum != (weight) tracker_checksum || tracker.get_netlength() != pack.compute_netlength())
+        {
+            std::cout << filename << ": the tracker computed a different netlength" << std::endl;
+        }
+
+        std::cout << std::setw(30) << std::left << filename << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << 1000 * full_time / num_moves << std::setw(14)
+                  << 1000 * tracker_time / num_moves << std::setprecision(0) << std::setw(10)
+                  << full_time / tracker_time << std::endl;
+    }
+}
+
+/**
+ * Compares the evaluators of sequence pairs on random instances with random sequence pairs. Instead of files, this
+ * gets the numbers of rectangles, e.g. benchmark.out sp_eval 10 1000 1000000
+ */
+static void bench_sp_eval(const std::vector<std::string> &sizes)
+{
+    std::cout << std::setw(12) << "rectangles" << std::setw(12) << "map [ms]" << std::setw(12) << "fast [ms]"
+              << std::setw(10) << "speedup" << std::endl;
+
+    const std::string instance_file = "/tmp/rechteckspackung_sp_eval.txt";
+
+    for (auto &size : sizes)
+    {
+        const size_t num_rects = std::stoul(size);
+        std::mt19937 generator(42);
+        {
+            std::ofstream out(instance_file);
+            out << "0 1000000000 0 1000000000" << std::endl;
+            for (size_t i = 0; i < num_rects; ++i)
+            {
+                out << 1 + generator() % 100 << " " << 1 + generator() % 100 << std::endl;
+            }
+        }
+
+        packing pack;
+        pack.read_inst_from(instance_file);
+
+        std::vector<size_t> order(num_rects);
+        std::iota(order.begin(), order.end(), 0);
+        sequence_pair sp;
+        std::shuffle(order.begin(), order.end(), generator);
+        sp.positive_locus = locus(order.begin(), order.end());
+        std::shuffle(order.begin(), order.end(), generator);
+        sp.negative_locus = locus(order.begin(), order.end());
+
+        // Small instances are repeated, so the clock resolution does not matter
+        const size_t repetitions = std::max<size_t>(1, 100000 / num_rects);
+        std::vector<pos> map_x, map_y, fast_x, fast_y;
+        const double map_time = time_best_of(5, [&]()
+        {
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                map_x = sp.place_dimension(dimension::x, pack, sp_evaluator::map);
+                map_y = sp.place_dimension(dimension::y, pack, sp_evaluator::map);
+            }
+        }) / repetitions;
+
+        // A search keeps its buffers for all evaluations
+        sp_scratch scratch;
+        const double fast_time = time_best_of(5, [&]()
+        {
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                fast_x = sp.place_dimension(dimension::x, pack, scratch);
+                fast_y = sp.place_dimension(dimension::y, pack, scratch);
+            }
+        }) / repetitions;
+
+        if (map_x != fast_x || map_y != fast_y)
+        {
+            std::cout << num_rects << ": the evaluators computed different coordinates" << std::endl;
+        }
+
+        std::cout << std::setw(12) << num_rects << std::fixed << std::setprecision(4) << std::setw(12) << map_time
+                  << std::setw(12) << fast_time << std::setprecision(2) << std::setw(9) << map_time / fast_time
+                  << "x" << std::endl;
+    }
+}
+
+/**
+ * Walks the k-local neighbours of placement_iterator and checks that incremental_sp_evaluator computes the same
+ * coordinates as place_dimension and the same bounds as sequence_pair::evaluate, then compares their running times.
+ */
+static void bench_sp_local(const std::vector<std::string> &files)
+{
+    const size_t max_steps = 20000;
+    std::cout << std::setw(30) << std::left << "instance" << std::right << std::setw(4) << "k" << std::setw(10)
+              << "steps" << std::setw(12) << "evaluate" << std::setw(13) << "incremental" << std::setw(10)
+              << "speedup" << "   [ms]" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing original;
+        original.read_inst_from(filename);
+
+        for (size_t k = 1; k <= 2 && k < original.get_num_rects(); ++k)
+        {
+            // Every walk starts from the same packing, since the iterator rotates its rectangles
+            auto walk = [&](const std::function<void(placement_iterator &, packing &)> &function)
+            {
+                packing pack = original;
+                placement_iterator pl_it(pack, k, true);
+                size_t steps = 0;
+                do
+                {
+                    function(pl_it, pack);
+                } while (++steps < max_steps && ++pl_it);
+                return steps;
+            };
+
+            incremental_sp_evaluator evaluator;
+            sp_scratch scratch;
+            const size_t steps = walk([&](placement_iterator &pl_it, packing &pack)
+            {
+                const sequence_pair &sp = *pl_it;
+                const sp_bounds bounds = evaluator.evaluate(sp, pack, pl_it.get_changed_rects());
+                const sp_bounds expected = sp.evaluate(pack, scratch);
+                bool same = bounds.fits == expected.fits;
+                if (same && bounds.fits)
+                {
+                    same = bounds.width == expected.width && bounds.height == expected.height
+                           && bounds.area == expected.area
+                           && evaluator.get_coordinates(dimension::x) == sp.place_dimension(dimension::x, pack)
+                           && evaluator.get_coordinates(dimension::y) == sp.place_dimension(dimension::y, pack);
+                }
+                if (!same)
+                {
+                    throw std::runtime_error("incremental_sp_evaluator differs from a full evaluation on " + filename);
+                }
+            });
+
+            const double evaluate_time = time_best_of(3, [&]()
+            {
+                walk([&](placement_iterator &pl_it, packing &pack)
+                {
+                    (*pl_it).evaluate(pack, scratch);
+                });
+            });
+            const double incremental_time = time_best_of(3, [&]()
+            {
+                incremental_sp_evaluator timed;
+                walk([&](placement_iterator &pl_it, packing &pack)
+                {
+                    timed.evaluate(*pl_it, pack, pl_it.get_changed_rects());
+                });
+            });
+
+            std::cout << std::setw(30) << std::left << filename << std::right << std::setw(4) << k << std::setw(10)
+                      << steps << std::fixed << std::setprecision(2) << std::setw(12) << evaluate_time
+                      << std::setw(13) << incremental_time << std::setw(9) << evaluate_time / incremental_time << "x"
+                      << std::endl;
+        }
+    }
+}
+
+/**
+ * Solves instances by branch and bound for the bounding rectangle, with the chip base of the instance and with copies
+ * of it shifted into all directions, partly to negative coordinates. Small instances are checked against the global
+ * enumeration of placement_iterator.
+ */
+static void bench_exact(const std::vector<std::string> &files)
+{
+    const size_t max_checked_rects = 6;
+    const std::string instance_file = "/tmp/rechteckspackung_exact.txt";
+
+    std::cout << std::setw(30) << std::left << "instance" << std::right << std::setw(24) << "chip base" << std::setw(8)
+              << "rects" << std::setw(12) << "nodes" << std::setw(12) << "[ms]" << std::setw(16) << "area"
+              << std::setw(10) << "checked" << std::endl;
+
+    for (auto &filename : files)
+    {
+        packing original;
+        original.read_inst_from(filename);
+        const rectangle &chip_base = original.get_chip_base();
+        const pos chip_width = chip_base.get_dimension(dimension::x);
+        const pos chip_height = chip_base.get_dimension(dimension::y);
+        const rect_store &store = original.get_rect_store();
+
+        const std::vector<std::pair<pos, pos>> shifts = {{0, 0}, {3 * chip_width, chip_height / 2},
+                                                         {-chip_width / 2, -chip_height / 3},
+                                                         {-3 * chip_width, -3 * chip_height}};
+        for (auto &shift : shifts)
+        {
+            const pos x = chip_base.get_pos(dimension::x) + shift.first;
+            const pos y = chip_base.get_pos(dimension::y) + shift.second;
+            {
+                std::ofstream out(instance_file);
+                out << x << " " << x + chip_width << " " << y << " " << y + chip_height << std::endl;
+                for (size_t i = 0; i < store.width.size(); ++i)
+                {
+                    out << store.width[i] << " " << store.height[i] << std::endl;
+                }
+            }
+
+            packing pack;
+            pack.read_inst_from(instance_file);
+
+            bool found = false;
+            int64_t area = 0;
+            uint64_t nodes = 0;
+            const double time = time_best_of(1, [&]()
+            {
+                branch_and_bound search(pack, false);
+                found = search.run();
+                area = search.get_best_value();
+                nodes = search.get_num_nodes();
+            });
+
+            const bool checked = pack.get_num_rects() <= max_checked_rects;
+            if (checked)
+            {
+                bool enumerated = false;
+                int64_t least = 0;
+                sp_scratch scratch;
+                placement_iterator pl_it(pack, 0, true);
+                do
+                {
+                    const sp_bounds bounds = (*pl_it).evaluate(pack, scratch);
+                    if (bounds.fits && (!enumerated || bounds.area < least))
+                    {
+                        enumerated = true;
+                        least = bounds.area;
+                    }
+                } while (++pl_it);
+
+                if (found != enumerated || (found && area != least))
+                {
+                    throw std::runtime_error("branch_and_bound misses the optimum of the enumeration on " + filename
+                                             + " with the chip base at " + std::to_string(x) + ", "
+                                             + std::to_string(y));
+                }
+            }
+
+            std::cout << std::setw(30) << std::left << filename << std::right << std::setw(24)
+                      << std::to_string(x) + ", " + std::to_string(y) << std::setw(8) << pack.get_num_rects()
+                      << std::setw(12) << nodes << std::fixed << std::setprecision(2) << std::setw(12) << time
+                      << std::setw(16) << (found ? std::to_string(area) : "none") << std::setw(10)
+                      << (checked ? "yes" : "no") << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: " << argv[0] << " benchmark files..." << std::endl
+                  << "Benchmarks on instances: read read_threads kernels netlength netlength_threads flow incremental"
+                  << " sp_local exact" << std::endl
+                  << "Benchmarks on solutions: write valid overlaps grid to_sp" << std::endl
+                  << "sp_eval takes numbers of rectangles instead of files, e.g. " << argv[0] << " sp_eval 10 1000"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string name(argv[1]);
+    std::vector<std::string> files(argv + 2, argv + argc);
+
+    if (name == "read")
+    {
+        bench_read(files);
+    }
+    else if (name == "read_threads")
+    {
+        bench_read_threads(files);
+    }
+    else if (name == "write")
+    {
+        bench_write(files);
+    }
+    else if (name == "valid")
+    {
+        bench_valid(files);
+    }
+    else if (name == "overlaps")
+    {
+        bench_overlaps(files);
+    }
+    else if (name == "grid")
+    {
+        bench_grid(files);
+    }
+    else if (name == "kernels")
+    {
+        bench_kernels(files);
+    }
+    else if (name == "netlength")
+    {
+        bench_netlength(files);
+    }
+    else if (name == "netlength_threads")
+    {
+        bench_netlength_threads(files);
+    }
+    else if (name == "flow")
+    {
+        bench_flow(files);
+    }
+    else if (name == "to_sp")
+    {
+        bench_to_sp(files);
+    }
+    else if (name == "sp_eval")
+    {
+        bench_sp_eval(files);
+    }
+    else if (name == "incremental")
+    {
+        bench_incremental(files);
+    }
+    else if (name == "sp_local")
+    {
+        bench_sp_local(files);
+    }
+    else if (name == "exact")
+    {
+        bench_exact(files);
+    }
+    else
+    {
+        std::cout << "Unknown benchmark " << name << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
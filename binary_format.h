@@ -0,0 +1,93 @@
+/*
+ * The binary format for instances and solutions. A file consists of a binary_header followed by flat arrays:
+ *   binary_rect  rects[num_rects]
+ *   int32_t      net_weights[num_nets]
+ *   uint32_t     pin_offsets[num_nets + 1]   (pins of net i are pins[pin_offsets[i], pin_offsets[i + 1]))
+ *   binary_pin   pins[num_pins]
+ * All fields are four bytes wide and stored in native byte order, so the file can be used directly after mapping it.
+ */
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+constexpr char BINARY_MAGIC[8] = {'R', 'P', 'A', 'C', 'K', 'B', 'I', 'N'};
+
+// Increase this whenever the layout changes
+constexpr uint32_t BINARY_VERSION = 1;
+
+enum class binary_kind : uint32_t
+{
+    instance = 0,
+    solution = 1
+};
+
+struct binary_header
+{
+    char magic[8];
+    uint32_t version;
+    binary_kind kind;
+
+    // x_min, x_max, y_min, y_max, only meaningful for instances
+    int32_t chip_base[4];
+
+    uint32_t num_rects;
+    uint32_t num_nets;
+    uint32_t num_pins;
+    uint32_t reserved;
+};
+
+struct binary_rect
+{
+    int32_t base_x;
+    int32_t base_y;
+
+    // The size of the unrotated rectangle
+    int32_t width;
+    int32_t height;
+
+    uint8_t placed;
+    uint8_t flipped;
+    uint8_t rot;
+    uint8_t reserved;
+};
+
+struct binary_pin
+{
+    int32_t index;
+    int32_t x;
+    int32_t y;
+};
+
+static_assert(sizeof(binary_header) == 48, "binary_header has to be packed");
+static_assert(sizeof(binary_rect) == 20, "binary_rect has to be packed");
+static_assert(sizeof(binary_pin) == 12, "binary_pin has to be packed");
+
+/**
+ * Checks whether the given range starts with the magic bytes of the binary format.
+ * @param begin The beginning of the file.
+ * @param end The end of the file.
+ * @return True if this is a binary file.
+ */
+inline bool is_binary_file(const char *begin, const char *end)
+{
+    return (size_t) (end - begin) >= sizeof(BINARY_MAGIC) && std::memcmp(begin, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+/**
+ * Returns the size in bytes which a file with the given header has to have.
+ * @param header The header of the file.
+ * @return The number of bytes of the header and all arrays.
+ */
+inline size_t binary_file_size(const binary_header &header)
+{
+    return sizeof(binary_header)
+           + header.num_rects * sizeof(binary_rect)
+           + header.num_nets * sizeof(int32_t)
+           + (header.num_nets + 1) * sizeof(uint32_t)
+           + header.num_pins * sizeof(binary_pin);
+}
+
+#endif // BINARY_FORMAT_H
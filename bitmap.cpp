@@ -62,28 +62,37 @@ void bitmap::write()
     }
 }
 
+template<dimension dim>
+void bitmap::draw_edges(const rectangle &rect, const pixel &color)
+{
+    constexpr dimension other = other_dimension(dim);
+    const int32_t lower = (rect.get_pos<other>() - base.coord<other>()) * scaling;
+    const int32_t upper = (rect.get_max<other>() - base.coord<other>()) * scaling;
+
+    for (int32_t i = scaling * (rect.get_pos<dim>() - base.coord<dim>());
+         i <= scaling * (rect.get_max<dim>() - base.coord<dim>()); ++i)
+    {
+        if (dim == dimension::x)
+        {
+            put_pixel(i, lower, color);
+            put_pixel(i, upper, color);
+        }
+        else
+        {
+            put_pixel(lower, i, color);
+            put_pixel(upper, i, color);
+        }
+    }
+}
+
 /**
  * Draws the edges of the specified rectangle with the specified color.
  * Applys scaling.
  */
 void bitmap::draw_rectangle(const rectangle &rect, const pixel &color)
 {
-    for (dimension dim : all_dimensions)
-    {
-        for (int32_t i = scaling * (rect.get_pos(dim) - base.coord(dim)); i <= scaling * (rect.get_max(dim) - base.coord(dim)); ++i)
-        {
-            if(dim == dimension::x)
-            {
-                put_pixel(i, (rect.get_pos(dim, true) - base.coord(dim, true)) * scaling, color);
-                put_pixel(i, (rect.get_max(dim, true) - base.coord(dim, true)) * scaling, color);
-            }
-            else
-            {
-                put_pixel((rect.get_pos(dim, true) - base.coord(dim, true)) * scaling, i, color);
-                put_pixel((rect.get_max(dim, true) - base.coord(dim, true)) * scaling, i, color);
-            }
-        }
-    }
+    draw_edges<dimension::x>(rect, color);
+    draw_edges<dimension::y>(rect, color);
 }
 
 /**
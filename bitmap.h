@@ -98,6 +98,13 @@ struct bitmap
     void write();
 
     void draw_rectangle(const rectangle &rect, const pixel &color);
+
+    /**
+     * Draws the two edges of the rectangle which are parallel to the given dimension.
+     */
+    template<dimension dim>
+    void draw_edges(const rectangle &rect, const pixel &color);
+
     void fill_rectangle(const rectangle &rect, const pixel &color);
     void draw_point(const point &p, const pixel &color);
 };
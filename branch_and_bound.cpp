@@ -0,0 +1,539 @@
+#include "branch_and_bound.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// The bound of a branch without any placement into the chip base
+static constexpr int64_t NO_BOUND = std::numeric_limits<int64_t>::max();
+
+// The area bound tries every integral width of the bounding rectangle if there are at most this many
+static constexpr int64_t ROUNDING_LIMIT = 256;
+
+branch_and_bound::branch_and_bound(packing &pack, bool netlength) :
+        _pack(pack),
+        _netlength(netlength),
+        _num_rects(pack.get_num_rects()),
+        _compact(pack.get_rect_store())
+{
+    const rect_store &store = pack.get_rect_store();
+    for (auto &widths : _widths)
+    {
+        widths.resize(_num_rects);
+    }
+    for (auto &heights : _heights)
+    {
+        heights.resize(_num_rects);
+    }
+
+    for (size_t i = 0; i < _num_rects; ++i)
+    {
+        const uint8_t current = store.orientation[i];
+        for (uint8_t orientation = 0; orientation < 8; ++orientation)
+        {
+            const bool turned = ((orientation ^ current) & 1) != 0;
+            _widths[orientation][i] = turned ? store.height[i] : store.width[i];
+            _heights[orientation][i] = turned ? store.width[i] : store.height[i];
+        }
+    }
+
+    // Interchangeable rectangles are appended to the negative locus in the order of their indices only
+    std::vector<size_t> group;
+    _pack.find_symmetries(netlength, group, _orientations);
+    _previous_in_group.assign(_num_rects, _num_rects);
+    std::vector<size_t> last_in_group(_num_rects, _num_rects);
+    for (size_t i = 0; i < _num_rects; ++i)
+    {
+        _previous_in_group[i] = last_in_group[group[i]];
+        last_in_group[group[i]] = i;
+    }
+}
+
+bool branch_and_bound::run()
+{
+    const rect_store &store = _pack.get_rect_store();
+    _found = false;
+    _num_nodes = 0;
+
+    _remaining_area = 0;
+    for (size_t i = 0; i < _num_rects; ++i)
+    {
+        _remaining_area += (int64_t) store.width[i] * store.height[i];
+    }
+
+    _negative.clear();
+    _positive.clear();
+    _placed.assign(_num_rects, false);
+    _orientation = store.orientation;
+    _x.assign(_num_rects, 0);
+    _y.assign(_num_rects, 0);
+    _tails[0].assign(_num_rects, 0);
+    _tails[1].assign(_num_rects, 0);
+    _positive_position.assign(_num_rects, 0);
+    _staircases.assign(_num_rects + 1, std::vector<corner>());
+    _staircase_areas.assign(_num_rects + 1, 0);
+    _children.assign(_num_rects + 1, std::vector<child>());
+
+    if (_num_rects == 0)
+    {
+        leaf(0);
+    }
+    else
+    {
+        branch(0);
+    }
+    return _found;
+}
+
+void branch_and_bound::branch(size_t depth)
+{
+    ++_num_nodes;
+    collect_children(depth);
+
+    // The children of deeper nodes go to their own vectors, so this one stays valid
+    for (const child &next : _children[depth])
+    {
+        // The children are sorted by their bounds
+        if (_found && next.bound >= _best_value)
+        {
+            break;
+        }
+
+        const pos width = _widths[next.orientation][next.rect];
+        const pos height = _heights[next.orientation][next.rect];
+        _placed[next.rect] = true;
+        _orientation[next.rect] = next.orientation;
+        _x[next.rect] = next.x;
+        _y[next.rect] = next.y;
+        _negative.push_back(next.rect);
+        _positive.insert(_positive.begin() + (std::ptrdiff_t) next.position, next.rect);
+        _remaining_area -= (int64_t) width * height;
+
+        // The staircase without the corners below and left of the new one
+        const corner added{next.x + width, next.y + height};
+        std::vector<corner> &staircase = _staircases[depth + 1];
+        staircase.clear();
+        bool covered = false;
+        bool inserted = false;
+        for (const corner &old : _staircases[depth])
+        {
+            if (old.x <= added.x && old.y <= added.y)
+            {
+                continue;
+            }
+            if (old.x >= added.x && old.y >= added.y)
+            {
+                covered = true;
+            }
+            if (!covered && !inserted && old.x > added.x)
+            {
+                staircase.push_back(added);
+                inserted = true;
+            }
+            staircase.push_back(old);
+        }
+        if (!covered && !inserted)
+        {
+            staircase.push_back(added);
+        }
+        _staircase_areas[depth + 1] = staircase_area(depth, added);
+
+        if (depth + 1 == _num_rects)
+        {
+            ++_num_nodes;
+            leaf(next.bound);
+        }
+        else
+        {
+            branch(depth + 1);
+        }
+
+        _remaining_area += (int64_t) width * height;
+        _positive.erase(_positive.begin() + (std::ptrdiff_t) next.position);
+        _negative.pop_back();
+        _placed[next.rect] = false;
+    }
+}
+
+void branch_and_bound::collect_children(size_t depth)
+{
+    std::vector<child> &children = _children[depth];
+    children.clear();
+
+    // A rectangle inserted at position p of the positive locus is right of the ones before and above the ones behind
+    _right_before.assign(depth + 1, 0);
+    _top_behind.assign(depth + 1, 0);
+    for (size_t p = 0; p < depth; ++p)
+    {
+        const size_t rect = _positive[p];
+        _right_before[p + 1] = std::max(_right_before[p], _x[rect] + _widths[_orientation[rect]][rect]);
+        _positive_position[rect] = p;
+    }
+    for (size_t p = depth; p-- > 0;)
+    {
+        const size_t rect = _positive[p];
+        _top_behind[p] = std::max(_top_behind[p + 1], _y[rect] + _heights[_orientation[rect]][rect]);
+    }
+
+    // For the area, a position is useless if another one is further left and not higher or lower and not further
+    // right: the rectangle could be moved there in every completion, the rectangles placed later are right of or above
+    // it anyway, and the sequence pair of the moved placement is found as well. For the netlength it may pay to leave
+    // a gap.
+    _useful.assign(depth + 1, true);
+    if (!_netlength)
+    {
+        // The coordinates grow from left to right in x and shrink in y
+        size_t first_of_run = 0;
+        for (size_t p = 1; p <= depth; ++p)
+        {
+            if (_top_behind[p] != _top_behind[first_of_run])
+            {
+                first_of_run = p;
+            }
+            _useful[p] = _right_before[first_of_run] == _right_before[p];
+        }
+        size_t last_of_run = depth;
+        for (size_t p = depth; p-- > 0;)
+        {
+            if (_right_before[p] != _right_before[last_of_run])
+            {
+                last_of_run = p;
+            }
+            _useful[p] = _useful[p] && _top_behind[last_of_run] == _top_behind[p];
+        }
+    }
+
+    const rectangle &chip_base = _pack.get_chip_base();
+    const pos chip_width = chip_base.get_dimension(dimension::x);
+    const pos chip_height = chip_base.get_dimension(dimension::y);
+    const std::vector<corner> &staircase = _staircases[depth];
+    const int64_t width_so_far = staircase.empty() ? 0 : staircase.back().x;
+    const int64_t height_so_far = staircase.empty() ? 0 : staircase.front().y;
+
+    for (size_t rect = 0; rect < _num_rects; ++rect)
+    {
+        if (_placed[rect] || (_previous_in_group[rect] < _num_rects && !_placed[_previous_in_group[rect]]))
+        {
+            continue;
+        }
+
+        for (uint8_t orientation : _orientations[rect])
+        {
+            const pos width = _widths[orientation][rect];
+            const pos height = _heights[orientation][rect];
+            const int64_t remaining_area = _remaining_area - (int64_t) width * height;
+            for (size_t p = 0; p <= depth; ++p)
+            {
+                const pos x = _right_before[p];
+                const pos y = _top_behind[p];
+                if (!_useful[p] || x + width > chip_width || y + height > chip_height)
+                {
+                    continue;
+                }
+
+                int64_t bound;
+                if (_netlength)
+                {
+                    _placed[rect] = true;
+                    _orientation[rect] = orientation;
+                    _x[rect] = x;
+                    _y[rect] = y;
+                    bound = netlength_bound(depth, rect, p);
+                    _placed[rect] = false;
+                }
+                else
+                {
+                    // The remaining rectangles lie outside the staircase, which grows by the new corner
+                    bound = area_bound(std::max<int64_t>(width_so_far, x + width),
+                                       std::max<int64_t>(height_so_far, y + height),
+                                       staircase_area(depth, corner{x + width, y + height}) + remaining_area);
+                }
+
+                if (bound < (_found ? _best_value : NO_BOUND))
+                {
+                    children.push_back(child{bound, rect, orientation, p, x, y});
+                }
+            }
+        }
+    }
+
+    std::stable_sort(children.begin(), children.end(), [](const child &first, const child &second)
+    {
+        return first.bound < second.bound;
+    });
+}
+
+int64_t branch_and_bound::area_bound(int64_t width, int64_t height, int64_t inner_area) const
+{
+    const rectangle &chip_base = _pack.get_chip_base();
+    const int64_t base_x = chip_base.get_pos(dimension::x);
+    const int64_t base_y = chip_base.get_pos(dimension::y);
+    const int64_t chip_width = chip_base.get_dimension(dimension::x);
+    const int64_t chip_height = chip_base.get_dimension(dimension::y);
+    if (width > chip_width || height > chip_height)
+    {
+        return NO_BOUND;
+    }
+
+    if (base_x + width < 0 || base_y + height < 0)
+    {
+        // A factor may be negative, so the area does not grow with the extents. It is bilinear in them, so its least
+        // value on the chip base is at a corner.
+        return std::min(std::min((base_x + width) * (base_y + height), (base_x + width) * (base_y + chip_height)),
+                        std::min((base_x + chip_width) * (base_y + height),
+                                 (base_x + chip_width) * (base_y + chip_height)));
+    }
+
+    // Both factors are non-negative and grow with the extents, so for a bounding width the least height holding the
+    // inner area is best. Wider than this, the height is the given one and the area only grows.
+    const int64_t widest = std::max(width, (inner_area + std::max<int64_t>(height, 1) - 1) / std::max<int64_t>(height, 1));
+    if (widest - width > ROUNDING_LIMIT)
+    {
+        return relaxed_area_bound(width, height, inner_area);
+    }
+
+    // Both extents are integers, e.g. no 11 x 13 bounding rectangle holds an area of 142 without waste
+    int64_t bound = NO_BOUND;
+    for (int64_t bounding_width = width; bounding_width <= std::min(widest, chip_width); ++bounding_width)
+    {
+        const int64_t bounding_height = std::max(height, (inner_area + bounding_width - 1) / std::max<int64_t>(bounding_width, 1));
+        if (bounding_height <= chip_height)
+        {
+            bound = std::min(bound, (base_x + bounding_width) * (base_y + bounding_height));
+        }
+    }
+    return bound;
+}
+
+int64_t branch_and_bound::relaxed_area_bound(int64_t width, int64_t height, int64_t inner_area) const
+{
+    const rectangle &chip_base = _pack.get_chip_base();
+    const long double base_x = chip_base.get_pos(dimension::x);
+    const long double base_y = chip_base.get_pos(dimension::y);
+    const long double inner = (long double) inner_area;
+
+    // The height can not exceed the chip base, so the width is at least inner / chip height
+    const long double chip_height = chip_base.get_dimension(dimension::y);
+    const long double lowest = std::max<long double>(width, chip_height > 0 ? inner / chip_height : 0);
+    const long double highest = chip_base.get_dimension(dimension::x);
+    if (lowest > highest)
+    {
+        return NO_BOUND;
+    }
+
+    // (base_x + w) * (base_y + max(height, inner / w)) for real widths w. Up to the width inner / height it is
+    // base_x * base_y + inner + base_y * w + base_x * inner / w, which is monotone or convex with its least value at
+    // sqrt(base_x * inner / base_y), and behind it it grows. So the least value is at one of these widths.
+    auto area = [&](long double w)
+    {
+        w = std::min(std::max(w, lowest), highest);
+        return (base_x + w) * (base_y + std::max<long double>(height, w > 0 ? inner / w : 0));
+    };
+    long double least = std::min(area(lowest), area(highest));
+    if (height > 0)
+    {
+        least = std::min(least, area(inner / height));
+    }
+    if (base_x > 0 && base_y > 0)
+    {
+        least = std::min(least, area(std::sqrt(base_x * inner / base_y)));
+    }
+
+    // The integral areas are at least this, one less makes up for rounding
+    return std::max<int64_t>((int64_t) std::floor(least) - 1, 0);
+}
+
+int64_t branch_and_bound::staircase_area(size_t depth, corner added) const
+{
+    // The part of [0, added.x) x [0, added.y) above the staircase, whose step at index i covers [x of i - 1, x of i)
+    int64_t area = _staircase_areas[depth];
+    pos left = 0;
+    for (const corner &step : _staircases[depth])
+    {
+        if (left >= added.x)
+        {
+            break;
+        }
+        if (added.y > step.y)
+        {
+            area += (int64_t) (std::min(step.x, added.x) - left) * (added.y - step.y);
+        }
+        left = step.x;
+    }
+    if (left < added.x)
+    {
+        area += (int64_t) (added.x - left) * added.y;
+    }
+    return area;
+}
+
+int64_t branch_and_bound::netlength_bound(size_t depth, size_t added, size_t position)
+{
+    // The longest chains right of and above every placed rectangle, the rectangles placed later are right of or
+    // above the earlier ones. The added one is the last, so nothing is right of or above it yet.
+    _tails[0][added] = 0;
+    _tails[1][added] = 0;
+    for (size_t i = depth; i-- > 0;)
+    {
+        const size_t rect = _negative[i];
+        pos tail_x = 0;
+        pos tail_y = 0;
+        if (_positive_position[rect] < position)
+        {
+            tail_x = _widths[_orientation[added]][added];
+        }
+        else
+        {
+            tail_y = _heights[_orientation[added]][added];
+        }
+        for (size_t j = i + 1; j < depth; ++j)
+        {
+            const size_t other = _negative[j];
+            if (_positive_position[rect] < _positive_position[other])
+            {
+                tail_x = std::max(tail_x, _widths[_orientation[other]][other] + _tails[0][other]);
+            }
+            else
+            {
+                tail_y = std::max(tail_y, _heights[_orientation[other]][other] + _tails[1][other]);
+            }
+        }
+        _tails[0][rect] = tail_x;
+        _tails[1][rect] = tail_y;
+    }
+
+    // The same bound as wire_annealer::lower_bound, the pins on rectangles which are not placed yet may be anywhere
+    const csr_netlist &netlist = _pack.get_netlist();
+    const rectangle &chip_base = _pack.get_chip_base();
+    const point chip_min = chip_base.base;
+    const point chip_max(chip_base.get_max(dimension::x), chip_base.get_max(dimension::y), true);
+
+    int64_t bound = 0;
+    for (size_t i = 0; i < netlist.num_nets(); ++i)
+    {
+        pos lowest_x = std::numeric_limits<pos>::min();
+        pos lowest_y = std::numeric_limits<pos>::min();
+        pos highest_x = std::numeric_limits<pos>::max();
+        pos highest_y = std::numeric_limits<pos>::max();
+        for (size_t k = netlist.net_begin(i); k < netlist.net_end(i); ++k)
+        {
+            const size_t rect = netlist.pin_rect(k);
+            pos min_x, min_y, max_x, max_y;
+            if (rect < _num_rects)
+            {
+                if (!_placed[rect])
+                {
+                    continue;
+                }
+                const uint8_t orientation = _orientation[rect];
+                const point offset = netlist.relative_position(k, orientation);
+                min_x = chip_min.x + _x[rect] + offset.x;
+                min_y = chip_min.y + _y[rect] + offset.y;
+                max_x = chip_max.x - _tails[0][rect] - _widths[orientation][rect] + offset.x;
+                max_y = chip_max.y - _tails[1][rect] - _heights[orientation][rect] + offset.y;
+            }
+            else
+            {
+                const point offset = netlist.relative_position(k, 0);
+                min_x = max_x = chip_min.x + offset.x;
+                min_y = max_y = chip_min.y + offset.y;
+            }
+            lowest_x = std::max(lowest_x, min_x);
+            lowest_y = std::max(lowest_y, min_y);
+            highest_x = std::min(highest_x, max_x);
+            highest_y = std::min(highest_y, max_y);
+        }
+
+        if (lowest_x != std::numeric_limits<pos>::min())
+        {
+            bound += (int64_t) netlist.net_weight(i)
+                     * (std::max(0, lowest_x - highest_x) + std::max(0, lowest_y - highest_y));
+        }
+    }
+    return bound;
+}
+
+void branch_and_bound::leaf(int64_t bound)
+{
+    int64_t value = bound;
+    if (_netlength)
+    {
+        // If the compact placement reaches the bound, it is optimal
+        const point &base = _pack.get_chip_base().base;
+        for (size_t i = 0; i < _num_rects; ++i)
+        {
+            _compact.x[i] = base.x + _x[i];
+            _compact.y[i] = base.y + _y[i];
+            _compact.orientation[i] = _orientation[i];
+            _compact.width[i] = _widths[_orientation[i]][i];
+            _compact.height[i] = _heights[_orientation[i]][i];
+        }
+        if (_pack.get_netlist().compute_hpwl(_compact, base, _hpwl_scratch) == bound)
+        {
+            record(bound);
+            return;
+        }
+
+        const weight netlength = _pack.compute_netlength_optimal(current(), _compact);
+        if (netlength == _invalid_cost)
+        {
+            return;
+        }
+        value = netlength;
+    }
+    else if (_num_rects != 0)
+    {
+        // The bound of a complete placement is its area
+        const std::vector<corner> &staircase = _staircases[_num_rects];
+        const rectangle &chip_base = _pack.get_chip_base();
+        value = ((int64_t) chip_base.get_pos(dimension::x) + staircase.back().x)
+                * ((int64_t) chip_base.get_pos(dimension::y) + staircase.front().y);
+    }
+
+    record(value);
+}
+
+void branch_and_bound::record(int64_t value)
+{
+    if (!_found || value < _best_value)
+    {
+        _found = true;
+        _best_value = value;
+        _best = current();
+        _best_orientation = _orientation;
+        if (_report)
+        {
+            _report(_best);
+        }
+    }
+}
+
+sequence_pair branch_and_bound::current() const
+{
+    sequence_pair sp;
+    sp.negative_locus = locus(_negative.begin(), _negative.end());
+    sp.positive_locus = locus(_positive.begin(), _positive.end());
+    return sp;
+}
+
+void branch_and_bound::apply_best()
+{
+    for (size_t i = 0; i < _num_rects; ++i)
+    {
+        if (_pack.get_rect_store().orientation[i] != _best_orientation[i])
+        {
+            _pack.set_orientation((int) i, _best_orientation[i]);
+        }
+    }
+
+    if (_netlength)
+    {
+        _pack.compute_netlength_optimal(_best);
+    }
+    else
+    {
+        sp_scratch scratch;
+        _best.evaluate(_pack, scratch);
+        sequence_pair::place_evaluated(_pack, scratch);
+    }
+}
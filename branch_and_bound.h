@@ -0,0 +1,194 @@
+#ifndef BRANCH_AND_BOUND_H
+#define BRANCH_AND_BOUND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "common.h"
+#include "netlist.h"
+#include "packing.h"
+#include "rect_store.h"
+#include "sequence_pair.h"
+
+/**
+ * An exact search over all sequence pairs and orientations, the same ones the global mode of placement_iterator
+ * enumerates, for the smallest bounding rectangle or the smallest netlength.
+ *
+ * Both loci are built together: the rectangles are appended to the negative locus one after another and every one is
+ * inserted somewhere into the positive locus of the rectangles so far. Every sequence pair is built exactly once this
+ * way. A rectangle appended later is never left of or below one appended before, so the coordinates of the placed
+ * rectangles are the ones they have in every completion, and no later rectangle can use the staircase below and left
+ * of their upper right corners. A branch is cut off as soon as a lower bound reaches the best value found:
+ * - for the area, the bounding rectangle so far, which has to hold the staircase and the remaining rectangles,
+ * - for the netlength, the distances between the ranges of the pins on placed rectangles, see wire_annealer, and the
+ *   flow problems are only solved for complete sequence pairs below the best value.
+ * The children of a node are visited in the order of their bounds, so good placements are found early. Interchangeable
+ * rectangles, see packing::find_symmetries, are appended in the order of their indices and only orientations which make
+ * a difference are tried, so sequence pairs which only exchange such rectangles are not searched again.
+ */
+class branch_and_bound
+{
+private:
+    // One way to place the next rectangle, with the lower bound of the values below it
+    struct child
+    {
+        int64_t bound;
+        size_t rect;
+        uint8_t orientation;
+        size_t position;
+        pos x;
+        pos y;
+    };
+
+    // An upper right corner of the staircase of the placed rectangles
+    struct corner
+    {
+        pos x;
+        pos y;
+    };
+
+    packing &_pack;
+    bool _netlength;
+    size_t _num_rects;
+
+    // The different orientations every rectangle may take and its extents in all orientations
+    std::vector<std::vector<uint8_t>> _orientations;
+    // The next smaller index of an interchangeable rectangle, the number of rectangles if there is none
+    std::vector<size_t> _previous_in_group;
+    std::vector<pos> _widths[8];
+    std::vector<pos> _heights[8];
+    int64_t _remaining_area = 0;
+
+    // The current branch: the rectangles in the order of the negative locus, the positive locus of them, and their
+    // orientations and coordinates relative to the chip base
+    std::vector<size_t> _negative;
+    std::vector<size_t> _positive;
+    std::vector<bool> _placed;
+    std::vector<uint8_t> _orientation;
+    std::vector<pos> _x;
+    std::vector<pos> _y;
+
+    // For every depth: the staircase sorted by x, its area, the children and scratch space for the bounds
+    std::vector<std::vector<corner>> _staircases;
+    std::vector<int64_t> _staircase_areas;
+    std::vector<std::vector<child>> _children;
+    std::vector<pos> _right_before;
+    std::vector<pos> _top_behind;
+    std::vector<bool> _useful;
+    std::vector<pos> _tails[2];
+    std::vector<size_t> _positive_position;
+
+    // The compact placement of the current branch, the flow problems write their optimal placement into it
+    rect_store _compact;
+    csr_netlist::scratch _hpwl_scratch;
+
+    bool _found = false;
+    int64_t _best_value = 0;
+    sequence_pair _best;
+    std::vector<uint8_t> _best_orientation;
+    uint64_t _num_nodes = 0;
+
+    std::function<void(const sequence_pair &)> _report;
+
+    /**
+     * Visits the children of a node with depth rectangles placed.
+     */
+    void branch(size_t depth);
+
+    /**
+     * Collects the children of a node which are not cut off, with their bounds.
+     */
+    void collect_children(size_t depth);
+
+    /**
+     * Computes a lower bound of the area of a bounding rectangle which fits into the chip base.
+     * @param width The least width, relative to the chip base.
+     * @param height The least height.
+     * @param inner_area The least area inside, measured from the chip base.
+     * @return The bound as packing::calculate_area measures it, NO_BOUND if no such rectangle fits.
+     */
+    int64_t area_bound(int64_t width, int64_t height, int64_t inner_area) const;
+
+    /**
+     * The bound of area_bound for non-negative factors with real instead of integral extents, for ranges of widths
+     * too large to try all of them.
+     */
+    int64_t relaxed_area_bound(int64_t width, int64_t height, int64_t inner_area) const;
+
+    /**
+     * Computes the area of the staircase of a depth with one more corner.
+     */
+    int64_t staircase_area(size_t depth, corner added) const;
+
+    /**
+     * Computes the bound of the netlength of the placed rectangles and one more, which is placed already but not in
+     * the positive locus yet.
+     * @param depth The number of rectangles placed before.
+     * @param added The rectangle.
+     * @param position Its position in the positive locus.
+     */
+    int64_t netlength_bound(size_t depth, size_t added, size_t position);
+
+    /**
+     * Evaluates a complete sequence pair and keeps it if it is the best one.
+     * @param bound The bound of its node.
+     */
+    void leaf(int64_t bound);
+
+    /**
+     * Keeps the current branch if its value is the best one so far.
+     */
+    void record(int64_t value);
+
+    /**
+     * Returns the sequence pair of the current branch.
+     */
+    sequence_pair current() const;
+
+public:
+    /**
+     * Prepares a search.
+     * @param pack The packing, its rectangles are oriented and placed by apply_best.
+     * @param netlength True to minimize the netlength with all orientations, false to minimize the bounding
+     * rectangle, for which only turning by 90 degrees matters.
+     */
+    branch_and_bound(packing &pack, bool netlength);
+
+    /**
+     * Sets a function which is called with the sequence pair whenever a better one was found.
+     */
+    void on_improvement(const std::function<void(const sequence_pair &)> &report)
+    {
+        _report = report;
+    }
+
+    /**
+     * Runs the search.
+     * @return True if a placement into the chip base exists.
+     */
+    bool run();
+
+    /**
+     * Rotates, flips and moves the rectangles of the packing to the best placement.
+     */
+    void apply_best();
+
+    /**
+     * Returns the best value: the area as packing::calculate_area or the netlength.
+     */
+    int64_t get_best_value() const
+    {
+        return _best_value;
+    }
+
+    /**
+     * Returns the number of nodes visited by the last run.
+     */
+    uint64_t get_num_nodes() const
+    {
+        return _num_nodes;
+    }
+};
+
+#endif // BRANCH_AND_BOUND_H
@@ -30,6 +30,16 @@ enum class dimension
 
 static auto all_dimensions = {dimension::x, dimension::y};
 
+/**
+ * Returns the other dimension, for code which gets the dimension as template parameter.
+ * @param dim A dimension.
+ * @return y for x and x for y.
+ */
+constexpr dimension other_dimension(dimension dim)
+{
+    return dim == dimension::x ? dimension::y : dimension::x;
+}
+
 inline std::string to_string(dimension dim)
 {
     switch (dim)
@@ -77,6 +87,23 @@ struct point
         std::swap(x, y);
     }
 
+    /**
+     * Returns the coordinate of a dimension known at compile time, this does not branch.
+     * @tparam dim The coordinate to be returned
+     * @return x if dim is dimension::x, y if dim is dimension::y
+     */
+    template<dimension dim>
+    const pos &coord() const
+    {
+        return dim == dimension::x ? x : y;
+    }
+
+    template<dimension dim>
+    pos &coord()
+    {
+        return dim == dimension::x ? x : y;
+    }
+
     /**
      * Returns the coordinate of the given dimension.
      * @param dim The coordinate to be returned
@@ -0,0 +1,75 @@
+/*
+ * Converts instances and solutions between the text and the binary format. The direction is inferred from the input:
+ * text files are converted to binary and binary files to text.
+ */
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "packing.h"
+
+static void print_usage(const char *name)
+{
+    std::cout << "Usage: " << name << R"( [--sol] input_file output_file
+
+Converts input_file from text to binary format or from binary to text format.
+--sol: The files contain solutions instead of instances.)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool solution = false;
+
+    if (!args.empty() && args.front() == "--sol")
+    {
+        solution = true;
+        args.erase(args.begin());
+    }
+
+    if (args.size() != 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const std::string &input_file = args[0];
+    const std::string &output_file = args[1];
+
+    bool binary_input;
+    {
+        mapped_file file(input_file);
+        binary_input = is_binary_file(file.begin(), file.end());
+    }
+
+    packing pack;
+    if (solution)
+    {
+        pack.read_sol_from(input_file);
+    }
+    else
+    {
+        pack.read_inst_from(input_file);
+    }
+
+    if (binary_input)
+    {
+        std::ofstream out(output_file);
+        if (solution)
+        {
+            out << pack;
+        }
+        else
+        {
+            pack.write_inst(out);
+        }
+    }
+    else
+    {
+        pack.write_binary(output_file, solution ? binary_kind::solution : binary_kind::instance);
+    }
+
+    std::cout << "Converted " << input_file << " to " << (binary_input ? "text" : "binary") << " file "
+              << output_file << std::endl;
+
+    return 0;
+}
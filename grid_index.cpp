@@ -0,0 +1,85 @@
+#include "grid_index.h"
+
+#include <algorithm>
+
+grid_index::grid_index(const bounds &area, pos cell_width, pos cell_height, size_t num_ids) :
+        _x_origin(area.x_min),
+        _y_origin(area.y_min),
+        _cell_width(std::max(cell_width, 1)),
+        _cell_height(std::max(cell_height, 1)),
+        _bounds(num_ids),
+        _stored(num_ids, false)
+{
+    const int64_t width = std::max<int64_t>((int64_t) area.x_max - area.x_min, 1);
+    const int64_t height = std::max<int64_t>((int64_t) area.y_max - area.y_min, 1);
+    _columns = (size_t) ((width + _cell_width - 1) / _cell_width);
+    _rows = (size_t) ((height + _cell_height - 1) / _cell_height);
+    _cells.resize(_columns * _rows);
+}
+
+bool grid_index::active() const
+{
+    return !_cells.empty();
+}
+
+grid_index::cell_range grid_index::cells_of(const bounds &box) const
+{
+    // The upper and right borders do not belong to the box
+    auto cell = [](pos coordinate, pos origin, pos cell_size, size_t count)
+    {
+        const int64_t offset = (int64_t) coordinate - origin;
+        if (offset <= 0)
+        {
+            return (size_t) 0;
+        }
+        return std::min((size_t) (offset / cell_size), count - 1);
+    };
+
+    return cell_range{cell(box.x_min, _x_origin, _cell_width, _columns),
+                      cell(box.x_max - 1, _x_origin, _cell_width, _columns),
+                      cell(box.y_min, _y_origin, _cell_height, _rows),
+                      cell(box.y_max - 1, _y_origin, _cell_height, _rows)};
+}
+
+void grid_index::update(uint32_t id, const bounds &box)
+{
+    erase(id);
+    if (!active() || box.empty())
+    {
+        return;
+    }
+
+    _bounds[id] = box;
+    _stored[id] = true;
+
+    const cell_range range = cells_of(box);
+    for (size_t row = range.first_row; row <= range.last_row; ++row)
+    {
+        for (size_t column = range.first_column; column <= range.last_column; ++column)
+        {
+            _cells[row * _columns + column].push_back(id);
+        }
+    }
+}
+
+void grid_index::erase(uint32_t id)
+{
+    if (!active() || !_stored[id])
+    {
+        return;
+    }
+    _stored[id] = false;
+
+    const cell_range range = cells_of(_bounds[id]);
+    for (size_t row = range.first_row; row <= range.last_row; ++row)
+    {
+        for (size_t column = range.first_column; column <= range.last_column; ++column)
+        {
+            // The cells are short, so a linear search is fine
+            auto &cell = _cells[row * _columns + column];
+            auto it = std::find(cell.begin(), cell.end(), id);
+            *it = cell.back();
+            cell.pop_back();
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef GRID_INDEX_H
+#define GRID_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "rectangle.h"
+
+/**
+ * A uniform grid over an area, every cell knows the rectangles intersecting it. If the cells have about the size of
+ * an average rectangle, a rectangle lies in O(1) cells and a query only looks at the rectangles near the queried
+ * window. Rectangles outside of the area are put into the border cells, so they are still found, just slower.
+ * A default constructed grid_index is inactive and does not store anything.
+ */
+class grid_index
+{
+private:
+    pos _x_origin = 0;
+    pos _y_origin = 0;
+    pos _cell_width = 1;
+    pos _cell_height = 1;
+    size_t _columns = 0;
+    size_t _rows = 0;
+
+    // _cells[row * _columns + column] contains the ids of the rectangles intersecting this cell
+    std::vector<std::vector<uint32_t>> _cells;
+    std::vector<bounds> _bounds;
+    std::vector<char> _stored;
+
+    struct cell_range
+    {
+        size_t first_column;
+        size_t last_column;
+        size_t first_row;
+        size_t last_row;
+    };
+
+    /**
+     * Computes the cells a non-empty box lies in, clamped to the grid.
+     */
+    cell_range cells_of(const bounds &box) const;
+
+public:
+    grid_index() = default;
+
+    /**
+     * Creates an empty grid.
+     * @param area The area covered by the grid.
+     * @param cell_width The width of a cell, at least 1.
+     * @param cell_height The height of a cell, at least 1.
+     * @param num_ids The ids of the rectangles have to be smaller than this.
+     */
+    grid_index(const bounds &area, pos cell_width, pos cell_height, size_t num_ids);
+
+    /**
+     * Checks whether this grid was built.
+     * @return True if the grid has cells.
+     */
+    bool active() const;
+
+    /**
+     * Stores the rectangle with the given id, replacing its old position if it was already stored. Empty boxes do not
+     * intersect anything and are not stored.
+     * @param id The id of the rectangle.
+     * @param box The current coordinates of the rectangle.
+     */
+    void update(uint32_t id, const bounds &box);
+
+    /**
+     * Removes the rectangle with the given id, does nothing if it is not stored.
+     * @param id The id of the rectangle.
+     */
+    void erase(uint32_t id);
+
+    /**
+     * Calls report once for every stored rectangle which intersects the window. The query stops as soon as report
+     * returns false.
+     * @tparam Function A function taking the id of a rectangle and returning whether to go on.
+     * @param window The window to query.
+     * @param report The function called for each rectangle.
+     * @return False if the query was stopped by report.
+     */
+    template<class Function>
+    bool query(const bounds &window, Function report) const;
+};
+
+template<class Function>
+bool grid_index::query(const bounds &window, Function report) const
+{
+    if (!active() || window.empty())
+    {
+        return true;
+    }
+
+    const cell_range range = cells_of(window);
+    for (size_t row = range.first_row; row <= range.last_row; ++row)
+    {
+        for (size_t column = range.first_column; column <= range.last_column; ++column)
+        {
+            for (const uint32_t id : _cells[row * _columns + column])
+            {
+                if (!_bounds[id].intersects(window))
+                {
+                    continue;
+                }
+
+                // A rectangle spanning several cells is only reported in the first cell it shares with the window
+                const cell_range cells = cells_of(_bounds[id]);
+                if (column != std::max(cells.first_column, range.first_column)
+                    || row != std::max(cells.first_row, range.first_row))
+                {
+                    continue;
+                }
+
+                if (!report(id))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif // GRID_INDEX_H
@@ -18,7 +18,11 @@ bool input_parser::get_switch(char ** begin, char ** end, const std::string & op
 packing input_parser::read_packing(std::string filename)
 {
 	packing pack;
-	pack.read_inst_from(filename);
+	pack.read_inst_from(filename, _num_threads);
+	if (_num_threads != 0)
+	{
+		pack.set_num_threads(_num_threads);
+	}
 	return pack;
 }
 
@@ -41,6 +45,21 @@ void input_parser::parse(int argc, char * argv[])
 		return;
 	}
 
+	std::string threads_arg = get_option(begin, end, "--threads");
+	if (!threads_arg.empty())
+	{
+		try
+		{
+			_num_threads = (unsigned)std::stoul(threads_arg);
+		}
+		catch (const std::logic_error&)
+		{
+			std::cout << threads_arg << " is not an allowed number of threads!" << std::endl;
+			print_help();
+			return;
+		}
+	}
+
 	std::string input_file(argv[1]);
 	packing pack = read_packing(input_file);
 
@@ -79,7 +98,46 @@ void input_parser::parse(int argc, char * argv[])
 	}
 
 	bool bitmap = get_switch(begin, end, "--bitmap");
-	if (get_switch(begin, end, "--rect"))
+	bool rect = get_switch(begin, end, "--rect");
+	if (get_switch(begin, end, "--anneal"))
+	{
+		anneal_options options;
+		if (!read_anneal_options(begin, end, options))
+		{
+			return;
+		}
+
+		if (rect)
+		{
+			anneal_bounding(pack, options, bitmap, output_file);
+		}
+		else
+		{
+			anneal_wirelength(pack, options, bitmap, output_file);
+		}
+		return;
+	}
+
+	if (get_switch(begin, end, "--tempering"))
+	{
+		anneal_options options;
+		if (!read_anneal_options(begin, end, options))
+		{
+			return;
+		}
+
+		if (rect)
+		{
+			temper_bounding(pack, options, bitmap, output_file);
+		}
+		else
+		{
+			temper_wirelength(pack, options, bitmap, output_file);
+		}
+		return;
+	}
+
+	if (rect)
 	{
 		optimize_bounding(pack, optimality, bitmap, output_file);
 		return;
@@ -91,6 +149,35 @@ void input_parser::parse(int argc, char * argv[])
 	}
 }
 
+bool input_parser::read_anneal_options(char ** begin, char ** end, anneal_options & options)
+{
+	std::string time_arg = get_option(begin, end, "--time");
+	std::string moves_arg = get_option(begin, end, "--moves");
+	std::string seed_arg = get_option(begin, end, "--seed");
+	try
+	{
+		if (!time_arg.empty())
+		{
+			options.time_limit = std::stod(time_arg);
+		}
+		if (!moves_arg.empty())
+		{
+			options.max_moves = std::stoull(moves_arg);
+		}
+		if (!seed_arg.empty())
+		{
+			options.seed = std::stoull(seed_arg);
+		}
+	}
+	catch (const std::logic_error&)
+	{
+		std::cout << "--time, --moves and --seed need numbers!" << std::endl;
+		print_help();
+		return false;
+	}
+	return true;
+}
+
 void input_parser::print_help()
 {
 	std::string help_text = R"(The program usese the following syntax:
@@ -99,9 +186,15 @@ input_file [options]
 Options are:
 --rect: Optimize size of bounding rectangle. 
 --wire: Optimize wirelength. Will be ignored if --rect is specified.
---global: Enumerate all possibilites.
+--global: Find an optimal placement by branch and bound over all sequence pairs and orientations.
 --local k: Find a k-optimal solution. k has to be an integer in [0, the number of rectangles). Will be ignored if --global is specified.
+--anneal: Search by simulated annealing over sequence pairs and orientations instead of enumerating. With --wire, the best netlength is printed whenever it improves.
+--time s: The time budget of --anneal in seconds, 10 by default.
+--moves n: Stop --anneal after n moves and cool down by moves instead of time, so runs with the same seed give the same result.
+--seed n: The seed of the random numbers of --anneal, 1 by default.
+--tempering: Like --anneal, but runs one chain per thread on a ladder from hot to cold, and neighbouring chains exchange their states. The temperature of every chain keeps adapting towards a target acceptance rate, from 1/2 for the hottest chain to 1/1000 for the coldest one. --time, --moves and --seed work the same, the limits hold for every chain.
 --bitmap: Write solution to bitmap. 
+--threads k: Use k threads for reading the instance and evaluating the netlength, and k chains for --tempering. By default, the number of threads for reading depends on the file size, the netlength is evaluated on one thread and --tempering uses all hardware threads.
 --help: Display this text.
 --out path: The name and path of the output file. Defaults to input file with ending .out added.
 
@@ -113,52 +206,118 @@ If no options are supplied, --global and --wire will be used.)";
 void input_parser::optimize_bounding(packing & pack, size_t optimality, bool bitmap, std::string output_file)
 {
 	std::cout << "Placing rectangles..." << std::endl;
+	if (optimality == 0)
+	{
+		branch_and_bound search(pack, false);
+		const bool found = search.run();
+		std::cout << "Searched " << search.get_num_nodes() << " nodes" << std::endl;
+		if (found)
+		{
+			search.apply_best();
+			write_bounding(pack, bitmap, output_file);
+		}
+		else
+		{
+			std::cout << "No valid placement was found with the given parameters!" << std::endl;
+		}
+		return;
+	}
+
 	packing best_pack;
 	pos min_area = std::numeric_limits<pos>::max();
 
 	placement_iterator pl_it(pack, optimality, true);
+	//Consecutive sequence pairs differ only in a few rectangles
+	incremental_sp_evaluator evaluator;
 	do
 	{
-		if ((*pl_it).apply_to(pack))
+		//The rectangles are only moved for a new best placement
+		const sp_bounds bounds = evaluator.evaluate(*pl_it, pack, pl_it.get_changed_rects());
+		if (bounds.fits && bounds.area < min_area)
 		{
-			pos cur_area = pack.calculate_area();
-			if (cur_area < min_area)
-			{
-				best_pack = pack;
-				min_area = cur_area;
-			}
+			(*pl_it).apply_to(pack, evaluator);
+			best_pack = pack;
+			min_area = bounds.area;
 		}
 	} while (++pl_it);
 
 	if (best_pack.get_num_rects() != 0) //Found placement
 	{
-		std::ofstream outfile(output_file);
-		outfile << best_pack;
-		outfile.flush();
+		write_bounding(best_pack, bitmap, output_file);
+	}
+	else //No placement found
+	{
+		std::cout << "No valid placement was found with the given parameters!" << std::endl;
+	}
+}
 
-		std::cout << "Output written to " << output_file << std::endl;
+void input_parser::anneal_bounding(packing & pack, const anneal_options & options, bool bitmap, std::string output_file)
+{
+	std::cout << "Annealing..." << std::endl;
+	area_annealer annealer(pack, options);
+	const bool found = annealer.run();
+	std::cout << annealer.get_num_moves() << " moves in " << annealer.get_seconds() << " s" << std::endl;
 
-		if (bitmap)
-		{
-			if (best_pack.init_bmp())
-			{
-				best_pack.draw_all_rectangles();
-				best_pack.write_bmp();
-			}
-			else
-			{
-				std::cout << "Instance is too big for a bitmap." << std::endl;
-			}
-		}
+	if (found)
+	{
+		annealer.apply_best(pack);
+		std::cout << "Area of best packing: " << pack.calculate_area() << std::endl;
+		write_bounding(pack, bitmap, output_file);
 	}
-	else //No placement found
+	else
 	{
 		std::cout << "No valid placement was found with the given parameters!" << std::endl;
 	}
 }
 
+void input_parser::write_bounding(packing & pack, bool bitmap, std::string output_file)
+{
+	//The file is written in the background while we draw the bitmap
+	solution_writer writer(output_file);
+	writer.write(pack, true);
+
+	if (bitmap)
+	{
+		if (pack.init_bmp())
+		{
+			pack.draw_all_rectangles();
+			pack.write_bmp();
+		}
+		else
+		{
+			std::cout << "Instance is too big for a bitmap." << std::endl;
+		}
+	}
+
+	writer.wait();
+	std::cout << "Output written to " << output_file << std::endl;
+}
+
 void input_parser::optimize_wirelength(packing & pack, size_t optimality, bool bitmap, std::string output_file)
 {
+	if (optimality == 0)
+	{
+		branch_and_bound search(pack, true);
+		search.on_improvement([](const sequence_pair & sp)
+		{
+			std::cout << sp;
+		});
+		const bool found = search.run();
+		std::cout << "Searched " << search.get_num_nodes() << " nodes" << std::endl;
+		std::cout << "Value of best packing: " << (found ? (weight)search.get_best_value() : _invalid_cost) << std::endl;
+		if (found)
+		{
+			search.apply_best();
+			write_wirelength(pack, bitmap, output_file);
+		}
+		else
+		{
+			packing no_packing;
+			write_wirelength(no_packing, bitmap, output_file);
+		}
+		return;
+	}
+
 	packing best_pack;
 	weight best_weight = _invalid_cost;
 	placement_iterator pl_it(pack, optimality, false);
@@ -176,25 +335,111 @@ void input_parser::optimize_wirelength(packing & pack, size_t optimality, bool b
 	}
 	std::cout << "Value of best packing: " << best_weight << std::endl;
 
-	std::ofstream outfile(output_file);
-	outfile << best_pack;
-	outfile.flush();
+	write_wirelength(best_pack, bitmap, output_file);
+}
 
-	std::cout << "Output written to " << output_file << std::endl;
+void input_parser::anneal_wirelength(packing & pack, const anneal_options & options, bool bitmap, std::string output_file)
+{
+	std::cout << "Annealing..." << std::endl;
+	wire_annealer annealer(pack, options);
+	annealer.on_improvement([](double seconds, weight netlength)
+	{
+		std::cout << seconds << " s: " << netlength << std::endl;
+	});
+	const bool found = annealer.run();
+	std::cout << annealer.get_num_moves() << " moves in " << annealer.get_seconds() << " s, "
+	          << annealer.get_num_exact() << " solved exactly" << std::endl;
+
+	if (found)
+	{
+		std::cout << "Value of best packing: " << annealer.apply_best(pack) << std::endl;
+		write_wirelength(pack, bitmap, output_file);
+	}
+	else
+	{
+		std::cout << "No valid placement was found with the given parameters!" << std::endl;
+	}
+}
+
+void input_parser::write_wirelength(packing & pack, bool bitmap, std::string output_file)
+{
+	//The file is written in the background while we draw the bitmap
+	solution_writer writer(output_file);
+	writer.write(pack, true);
 
 	if (bitmap)
 	{
-		if (best_pack.init_bmp())
+		if (pack.init_bmp())
 		{
-			best_pack.draw_all_rectangles();
-			best_pack.draw_all_nets();
-			best_pack.draw_all_pins();
-			best_pack.write_bmp();
+			pack.draw_all_rectangles();
+			pack.draw_all_nets();
+			pack.draw_all_pins();
+			pack.write_bmp();
 		}
 		else
 		{
 			std::cout << "Instance is too big for a bitmap." << std::endl;
 		}
 	}
+
+	writer.wait();
+	std::cout << "Output written to " << output_file << std::endl;
 }
 
+template<class chain_type>
+void input_parser::print_tempering_stats(const tempering<chain_type> & search)
+{
+	for (size_t k = 0; k < search.get_num_chains(); ++k)
+	{
+		std::cout << "Thread " << k << ": " << search.get_num_moves(k) << " moves, "
+		          << (double)search.get_num_moves(k) / search.get_seconds() << " moves/s" << std::endl;
+	}
+	std::cout << search.get_num_accepted_exchanges() << " of " << search.get_num_exchanges()
+	          << " exchanges accepted in " << search.get_seconds() << " s" << std::endl;
+}
+
+size_t input_parser::get_num_chains() const
+{
+	return _num_threads != 0 ? _num_threads : default_num_threads();
+}
+
+void input_parser::temper_bounding(packing & pack, const anneal_options & options, bool bitmap, std::string output_file)
+{
+	std::cout << "Tempering..." << std::endl;
+	tempering<area_annealer> search(pack, options, get_num_chains());
+	const bool found = search.run();
+	print_tempering_stats(search);
+
+	if (found)
+	{
+		search.get_best().apply_best(pack);
+		std::cout << "Area of best packing: " << pack.calculate_area() << std::endl;
+		write_bounding(pack, bitmap, output_file);
+	}
+	else
+	{
+		std::cout << "No valid placement was found with the given parameters!" << std::endl;
+	}
+}
+
+void input_parser::temper_wirelength(packing & pack, const anneal_options & options, bool bitmap, std::string output_file)
+{
+	std::cout << "Tempering..." << std::endl;
+	tempering<wire_annealer> search(pack, options, get_num_chains());
+	search.on_improvement([](double seconds, double netlength)
+	{
+		std::cout << seconds << " s: " << (weight)netlength << std::endl;
+	});
+	const bool found = search.run();
+	print_tempering_stats(search);
+
+	if (found)
+	{
+		std::cout << "Value of best packing: " << search.get_best().apply_best(pack) << std::endl;
+		write_wirelength(pack, bitmap, output_file);
+	}
+	else
+	{
+		std::cout << "No valid placement was found with the given parameters!" << std::endl;
+	}
+}
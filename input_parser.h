@@ -7,13 +7,48 @@
 #include <fstream>
 #include "packing.h"
 #include "placement_iterator.h"
+#include "annealer.h"
+#include "branch_and_bound.h"
+#include "parallel.h"
+#include "solution_writer.h"
 
 class input_parser
 {
 private:
+	// From --threads, 0 if the option is missing
+	unsigned _num_threads = 0;
+
 	std::string get_option(char** begin, char** end, const std::string & option);
 	bool get_switch(char** begin, char** end, const std::string & option);
 	packing read_packing(std::string filename);
+
+	/**
+	 * Reads --time, --moves and --seed. Prints the help if one of them is no number.
+	 * @return False if the options were invalid.
+	 */
+	bool read_anneal_options(char** begin, char** end, anneal_options & options);
+
+	/**
+	 * Writes a packing found by optimize_bounding or anneal_bounding and its bitmap if requested.
+	 */
+	void write_bounding(packing & pack, bool bitmap, std::string output_file);
+
+	/**
+	 * Writes a packing found by optimize_wirelength or anneal_wirelength and its bitmap with nets if requested.
+	 */
+	void write_wirelength(packing & pack, bool bitmap, std::string output_file);
+
+	/**
+	 * Prints the throughput of every thread of a tempering run and how many exchanges were accepted.
+	 */
+	template<class chain_type>
+	void print_tempering_stats(const tempering<chain_type> & search);
+
+	/**
+	 * Returns the number of chains for --tempering.
+	 * @return The number from --threads, the number of hardware threads without it.
+	 */
+	size_t get_num_chains() const;
 public:
 	/**
 	 * Parses command line arguments and acts on them.
@@ -33,6 +68,16 @@ public:
 	 */
 	void optimize_bounding(packing & pack, size_t optimality, bool bitmap, std::string output_file);
 
+	/**
+	 * Searches a placement with a small bounding rectangle by simulated annealing, see area_annealer.
+	 * Writes the best solution to the given path when there is one, writes error to console otherwise.
+	 * @param pack The packing that should be placed.
+	 * @param options The time budget, number of moves and seed.
+	 * @param bitmap Indicates whether to output a bitmap of the best placement.
+	 * @param output_file The path where to write the output to.
+	 */
+	void anneal_bounding(packing & pack, const anneal_options & options, bool bitmap, std::string output_file);
+
 	/**
 	* Finds a k-optimal placement regarding the wirelength of all nets for the given packing.
 	* Writes the solution to the given path when there is one, writes error to console otherwise.
@@ -42,6 +87,38 @@ public:
 	* @param output_file The path where to write the output to.
 	*/
 	void optimize_wirelength(packing & pack, size_t optimality, bool bitmap, std::string output_file);
+
+	/**
+	 * Searches a placement with a small netlength by simulated annealing, see wire_annealer. Prints the best
+	 * netlength whenever it improves.
+	 * Writes the best solution to the given path when there is one, writes error to console otherwise.
+	 * @param pack The packing that should be placed.
+	 * @param options The time budget, number of moves and seed.
+	 * @param bitmap Indicates whether to output a bitmap of the best placement.
+	 * @param output_file The path where to write the output to.
+	 */
+	void anneal_wirelength(packing & pack, const anneal_options & options, bool bitmap, std::string output_file);
+
+	/**
+	 * Searches a placement with a small bounding rectangle by parallel tempering, see tempering.
+	 * Writes the best solution to the given path when there is one, writes error to console otherwise.
+	 * @param pack The packing that should be placed.
+	 * @param options The time budget, number of moves and seed of every chain.
+	 * @param bitmap Indicates whether to output a bitmap of the best placement.
+	 * @param output_file The path where to write the output to.
+	 */
+	void temper_bounding(packing & pack, const anneal_options & options, bool bitmap, std::string output_file);
+
+	/**
+	 * Searches a placement with a small netlength by parallel tempering, see tempering. Prints the best netlength
+	 * whenever it improves.
+	 * Writes the best solution to the given path when there is one, writes error to console otherwise.
+	 * @param pack The packing that should be placed.
+	 * @param options The time budget, number of moves and seed of every chain.
+	 * @param bitmap Indicates whether to output a bitmap of the best placement.
+	 * @param output_file The path where to write the output to.
+	 */
+	void temper_wirelength(packing & pack, const anneal_options & options, bool bitmap, std::string output_file);
 };
 
 #endif // !INPUT_PARSER_H
@@ -0,0 +1,295 @@
+#include "instance_scanner.h"
+
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+void instance_scanner::skip_blanks()
+{
+    while (_cur != _end && (*_cur == ' ' || *_cur == '\t' || *_cur == '\r'))
+    {
+        ++_cur;
+    }
+}
+
+void instance_scanner::skip_whitespace()
+{
+    while (_cur != _end && (*_cur == ' ' || *_cur == '\t' || *_cur == '\r' || *_cur == '\n'))
+    {
+        ++_cur;
+    }
+}
+
+void instance_scanner::skip_line()
+{
+    if (_cur == _end)
+    {
+        return;
+    }
+
+    const char *line_end = static_cast<const char *>(std::memchr(_cur, '\n', (size_t) (_end - _cur)));
+    _cur = line_end == nullptr ? _end : line_end + 1;
+}
+
+bool instance_scanner::at_line_end()
+{
+    skip_blanks();
+    return _cur == _end || *_cur == '\n';
+}
+
+bool instance_scanner::read_number(int &value)
+{
+    const char *it = _cur;
+    bool negative = false;
+
+    if (it != _end && (*it == '-' || *it == '+'))
+    {
+        negative = *it == '-';
+        ++it;
+    }
+
+    if (it == _end || *it < '0' || *it > '9')
+    {
+        return false;
+    }
+
+    // Like operator>>, a value out of the range of int is no number
+    const int64_t limit = negative ? -(int64_t) std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+    int64_t result = 0;
+    while (it != _end && *it >= '0' && *it <= '9')
+    {
+        result = 10 * result + (*it - '0');
+        if (result > limit)
+        {
+            return false;
+        }
+        ++it;
+    }
+
+    value = (int) (negative ? -result : result);
+    _cur = it;
+    return true;
+}
+
+/**
+ * A line has two values for unplaced rectangles, four for the chip base and six for placed rectangles.
+ */
+bool instance_scanner::read_rectangle(rectangle &rect)
+{
+    skip_whitespace();
+
+    if (_cur == _end)
+    {
+        return false;
+    }
+
+    if (*_cur == 'B')
+    {
+        // We read a blockage
+        rect.blockage = true;
+        skip_line();
+        return true;
+    }
+
+    pos values[6];
+    size_t count = 0;
+    while (count < 6 && read_number(values[count]))
+    {
+        ++count;
+        skip_blanks();
+    }
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    if (count == 1)
+    {
+        throw std::runtime_error("Invalid format for point, only one value provided.");
+    }
+
+    if (!at_line_end())
+    {
+        if (*_cur == '-' || *_cur == '+' || (*_cur >= '0' && *_cur <= '9'))
+        {
+            // A number out of the range of int fails like in operator>>, the caller raises the error
+            return false;
+        }
+        throw std::runtime_error("Invalid format for rectangle.");
+    }
+
+    switch (count)
+    {
+        case 2:
+            // So we read width and height of an unplaced rectangle
+            rect.size = point(values[0], values[1], true);
+            break;
+        case 4:
+            // We read the chip base rectangle
+            rect.base = point(values[0], values[2], true);
+            rect.size = point(values[1] - values[0], values[3] - values[2], true);
+            rect.id = -1;
+            break;
+        case 6:
+            // So we are reading a placed rectangle
+            rect.base = point(values[0], values[2], true);
+            rect.size = point(values[1] - values[0], values[3] - values[2], true);
+            rect.flipped = values[4] != 0;
+            rect.rot = static_cast<rotation>(values[5]);
+
+            if (rect.rotated())
+            {
+                rect.size.swap();
+            }
+            break;
+        default:
+            throw std::runtime_error("Invalid format for rectangle.");
+    }
+
+    if (rect.size.x < 0 || rect.size.y < 0)
+    {
+        throw std::runtime_error("Invalid rectangle size.");
+    }
+
+    skip_line();
+    return true;
+}
+
+bool instance_scanner::read_net(net &n)
+{
+    n.pin_list.clear();
+    skip_whitespace();
+
+    if (_end - _cur < 3 || std::strncmp(_cur, "Net", 3) != 0)
+    {
+        return false;
+    }
+    const char *line = _cur;
+    _cur += 3;
+
+    skip_blanks();
+    if (!read_number(n.net_weight))
+    {
+        _cur = line;
+        return false;
+    }
+
+    pin p;
+    while (true)
+    {
+        skip_whitespace();
+        if (!read_number(p.index))
+        {
+            break;
+        }
+
+        skip_whitespace();
+        if (!read_number(p.position.x))
+        {
+            throw std::runtime_error("Invalid format for net, pin position not specified.");
+        }
+
+        skip_whitespace();
+        if (!read_number(p.position.y))
+        {
+            throw std::runtime_error("Invalid format for point, only one value provided.");
+        }
+
+        p.position.set = true;
+        n.pin_list.push_back(p);
+    }
+
+    return true;
+}
+
+const char *instance_scanner::count_rectangles(size_t &num_rects) const
+{
+    num_rects = 0;
+
+    const char *line = _cur;
+    while (line < _end)
+    {
+        const char *first = line;
+        while (first != _end && (*first == ' ' || *first == '\t'))
+        {
+            ++first;
+        }
+
+        if (first != _end)
+        {
+            if (*first == 'N')
+            {
+                return line;
+            }
+            else if (*first != '\n' && *first != '\r')
+            {
+                ++num_rects;
+            }
+        }
+
+        const char *line_end = static_cast<const char *>(std::memchr(first, '\n', (size_t) (_end - first)));
+        line = line_end == nullptr ? _end : line_end + 1;
+    }
+
+    return _end;
+}
+
+size_t instance_scanner::count_nets() const
+{
+    size_t num_nets = 0;
+
+    const char *line = _cur;
+    while (line < _end)
+    {
+        if (*line == 'N')
+        {
+            ++num_nets;
+        }
+
+        const char *line_end = static_cast<const char *>(std::memchr(line, '\n', (size_t) (_end - line)));
+        line = line_end == nullptr ? _end : line_end + 1;
+    }
+
+    return num_nets;
+}
+
+bool instance_scanner::at_end()
+{
+    skip_whitespace();
+    return _cur == _end;
+}
+
+const char *instance_scanner::position() const
+{
+    return _cur;
+}
+
+std::vector<const char *> instance_scanner::split_lines(const char *begin, const char *end, size_t num_chunks,
+                                                        char first_char)
+{
+    std::vector<const char *> borders(1, begin);
+    const size_t length = (size_t) (end - begin);
+
+    for (size_t i = 1; i < num_chunks; ++i)
+    {
+        const char *border = std::max(begin + i * (length / num_chunks), borders.back());
+
+        // Move forward to the beginning of a line at which we may split
+        while (border < end && border != begin
+               && (border[-1] != '\n' || (first_char != 0 && *border != first_char)))
+        {
+            const char *line_end = static_cast<const char *>(std::memchr(border, '\n', (size_t) (end - border)));
+            border = line_end == nullptr ? end : line_end + 1;
+        }
+
+        if (border > borders.back() && border < end)
+        {
+            borders.push_back(border);
+        }
+    }
+
+    borders.push_back(end);
+    return borders;
+}
@@ -0,0 +1,111 @@
+#ifndef INSTANCE_SCANNER_H
+#define INSTANCE_SCANNER_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "common.h"
+#include "rectangle.h"
+#include "net.h"
+
+/**
+ * A hand-written scanner for the text format of instances and solutions. It works directly on a character range
+ * (usually a mapped_file) and does not copy anything, so it is a lot faster than the stream operators. It accepts the
+ * same format as operator>> of rectangle and net and throws the same errors.
+ */
+class instance_scanner
+{
+private:
+    const char *_cur;
+    const char *_end;
+
+    /**
+     * Skips spaces, tabs and carriage returns, but not line breaks.
+     */
+    void skip_blanks();
+
+    /**
+     * Skips all whitespace including line breaks.
+     */
+    void skip_whitespace();
+
+    /**
+     * Skips everything up to and including the next line break.
+     */
+    void skip_line();
+
+    /**
+     * Checks whether only blanks are left in the current line.
+     * @return True if the next character is a line break or the end of the input.
+     */
+    bool at_line_end();
+
+    /**
+     * Parses an integer starting at the current position. Nothing is consumed if there is no integer or it does not
+     * fit into an int.
+     * @param value The parsed integer is written here.
+     * @return True if an integer was read.
+     */
+    bool read_number(int &value);
+
+public:
+    instance_scanner(const char *begin, const char *end) :
+            _cur(begin),
+            _end(end)
+    {}
+
+    /**
+     * Reads a rectangle, works for blockages and rectangles (unplaced and placed) just as operator>>.
+     * @param rect The rectangle to fill.
+     * @return False if there is no rectangle at the current position, e.g. since the net section starts.
+     */
+    bool read_rectangle(rectangle &rect);
+
+    /**
+     * Reads a net including all of its pins.
+     * @param n The net to fill, its pin list is cleared before.
+     * @return False if there is no net at the current position or its weight is missing.
+     */
+    bool read_net(net &n);
+
+    /**
+     * Counts the rectangle lines (including blockages and the chip base) from the current position up to the first
+     * net without consuming anything. This is meant for reserving memory up front.
+     * @param num_rects The number of non-empty lines before the first net.
+     * @return The beginning of the line of the first net, the end of the input if there is no net.
+     */
+    const char *count_rectangles(size_t &num_rects) const;
+
+    /**
+     * Counts the lines starting with a net from the current position to the end without consuming anything.
+     * @return The number of nets.
+     */
+    size_t count_nets() const;
+
+    /**
+     * Checks whether only whitespace is left.
+     * @return True if there is nothing more to read.
+     */
+    bool at_end();
+
+    /**
+     * Returns the current position of the scanner.
+     * @return _cur
+     */
+    const char *position() const;
+
+    /**
+     * Splits [begin, end) into at most num_chunks ranges of roughly equal size. Each range starts at the beginning
+     * of a line, if first_char is not 0 only lines starting with this character are used as borders. This way the
+     * net section can be split at net borders.
+     * @param begin The beginning of the range, has to be the beginning of a line.
+     * @param end The end of the range.
+     * @param num_chunks The number of chunks we want.
+     * @param first_char The first character of lines at which we may split, 0 for all lines.
+     * @return The borders of the chunks, the first is begin and the last is end. Empty chunks are skipped.
+     */
+    static std::vector<const char *> split_lines(const char *begin, const char *end, size_t num_chunks,
+                                                 char first_char = 0);
+};
+
+#endif // INSTANCE_SCANNER_H
@@ -0,0 +1,44 @@
+#include "interval_tree.h"
+
+interval_tree::interval_tree(size_t num_slabs, std::vector<size_t> first_slab, std::vector<size_t> end_slab) :
+        _leaves(1),
+        _first_slab(std::move(first_slab)),
+        _end_slab(std::move(end_slab)),
+        _alive(_first_slab.size(), false)
+{
+    while (_leaves < num_slabs)
+    {
+        _leaves *= 2;
+    }
+
+    // Count the entries of every node, then turn the counts into offsets
+    _offset.assign(2 * _leaves + 1, 0);
+    for (uint32_t id = 0; id < _first_slab.size(); ++id)
+    {
+        for_each_node(id, [this](size_t node)
+        {
+            ++_offset[node + 1];
+        });
+    }
+    for (size_t node = 0; node < 2 * _leaves; ++node)
+    {
+        _offset[node + 1] += _offset[node];
+    }
+
+    _count.assign(2 * _leaves, 0);
+    _items.resize(_offset.back());
+}
+
+void interval_tree::insert(uint32_t id)
+{
+    _alive[id] = true;
+    for_each_node(id, [this, id](size_t node)
+    {
+        _items[_offset[node] + _count[node]++] = id;
+    });
+}
+
+void interval_tree::erase(uint32_t id)
+{
+    _alive[id] = false;
+}
@@ -0,0 +1,104 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * A segment tree over a fixed set of elementary slabs [0, num_slabs) which answers stabbing queries, i.e. which of
+ * the active intervals contain a given slab. All intervals are known in advance, so the O(log n) nodes storing each
+ * of them can be counted beforehand and the node lists are slices of one flat array. Erased intervals are only marked
+ * and dropped from the node lists when a query passes them, so every stored entry is removed at most once and a query
+ * costs O(log n + k) amortized, where k is the number of reported intervals.
+ */
+class interval_tree
+{
+private:
+    size_t _leaves;
+    std::vector<size_t> _first_slab;
+    std::vector<size_t> _end_slab;
+
+    // The entries of node v are _items[_offset[v], _offset[v] + _count[v])
+    std::vector<size_t> _offset;
+    std::vector<uint32_t> _count;
+    std::vector<uint32_t> _items;
+    std::vector<char> _alive;
+
+    /**
+     * Calls visit for every node in the canonical decomposition of the interval.
+     */
+    template<class Function>
+    void for_each_node(uint32_t id, Function visit) const;
+
+public:
+    /**
+     * Creates a tree without active intervals.
+     * @param num_slabs The number of elementary slabs.
+     * @param first_slab The first slab of every interval.
+     * @param end_slab The first slab behind every interval.
+     */
+    interval_tree(size_t num_slabs, std::vector<size_t> first_slab, std::vector<size_t> end_slab);
+
+    /**
+     * Activates the interval with the given id. Every interval may only be inserted once.
+     * @param id The index of the interval in the vectors given to the constructor.
+     */
+    void insert(uint32_t id);
+
+    /**
+     * Deactivates the interval with the given id.
+     * @param id The index of the interval in the vectors given to the constructor.
+     */
+    void erase(uint32_t id);
+
+    /**
+     * Calls report for every active interval containing the slab.
+     * @tparam Function A function taking the id of an interval.
+     * @param slab The slab to query.
+     * @param report The function called for each interval.
+     */
+    template<class Function>
+    void stab(size_t slab, Function report);
+};
+
+template<class Function>
+void interval_tree::for_each_node(uint32_t id, Function visit) const
+{
+    // The usual bottom-up decomposition of [first_slab, end_slab) into canonical nodes
+    for (size_t left = _first_slab[id] + _leaves, right = _end_slab[id] + _leaves; left < right; left /= 2, right /= 2)
+    {
+        if (left & 1)
+        {
+            visit(left++);
+        }
+        if (right & 1)
+        {
+            visit(--right);
+        }
+    }
+}
+
+template<class Function>
+void interval_tree::stab(size_t slab, Function report)
+{
+    for (size_t node = slab + _leaves; node > 0; node /= 2)
+    {
+        uint32_t *items = _items.data() + _offset[node];
+
+        // Report the living intervals and compact the dead ones away
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < _count[node]; ++i)
+        {
+            if (_alive[items[i]])
+            {
+                items[kept++] = items[i];
+                report(items[i]);
+            }
+        }
+        _count[node] = kept;
+    }
+}
+
+#endif // INTERVAL_TREE_H
@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mapped_file::mapped_file(const std::string &filename) :
+        _data(nullptr),
+        _size(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("File not " + filename + " not found.");
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Could not read size of file " + filename + ".");
+    }
+
+    _size = (size_t) info.st_size;
+
+    // mmap refuses to map zero bytes, an empty file is just an empty range
+    if (_size > 0)
+    {
+        void *mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Could not map file " + filename + " into memory.");
+        }
+
+        // We read the file exactly once from front to back
+        madvise(mapping, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(mapping);
+    }
+
+    // The mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (_data != nullptr)
+    {
+        munmap(const_cast<char *>(_data), _size);
+    }
+}
+
+const char *mapped_file::begin() const
+{
+    return _data;
+}
+
+const char *mapped_file::end() const
+{
+    return _data + _size;
+}
+
+size_t mapped_file::size() const
+{
+    return _size;
+}
@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+
+/**
+ * A read-only view of a whole file which is mapped into memory. The mapping is released when the object is destroyed.
+ */
+class mapped_file
+{
+private:
+    const char *_data;
+    size_t _size;
+
+public:
+    /**
+     * Maps the given file into memory.
+     * @param filename The name of the file to map.
+     */
+    explicit mapped_file(const std::string &filename);
+
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    /**
+     * Returns a pointer to the first byte of the file.
+     * @return The beginning of the mapping, may be nullptr for empty files.
+     */
+    const char *begin() const;
+
+    /**
+     * Returns a pointer behind the last byte of the file.
+     * @return begin() + size()
+     */
+    const char *end() const;
+
+    /**
+     * Returns the size of the file in bytes.
+     * @return _size
+     */
+    size_t size() const;
+};
+
+#endif // MAPPED_FILE_H
@@ -1,5 +1,8 @@
 #include "min_cost_flow.h"
 
+#include <functional>
+#include <queue>
+
 
 void graph::augment_path(path &p, weight w)
 {
@@ -63,46 +66,45 @@ bool graph::compute_min_flow()
 }
 
 
-// This is O(n^2)-dijkstra. It suffices for the requested runtime and right now I am too lazy for something better.
+// Dijkstra with a binary heap, nodes which are already fixed are skipped when they come up again
 weight graph::compute_shortest_path(path &ret)
 {
+    typedef std::pair<weight, size_t> queue_entry;
+
     std::vector<weight> distances(_potential.size(), _invalid_cost);
     distances.at(0) = 0;
-    //path ret;
     std::vector<size_t> prev_edges(_list.size());
     std::vector<bool> fix(_list.size(), false);
 
-    size_t cur_node = 0;
+    std::priority_queue<queue_entry, std::vector<queue_entry>, std::greater<queue_entry>> queue;
+    queue.emplace(0, 0);
 
-    while (cur_node != _invalid_index)
+    while (!queue.empty())
     {
-        fix.at(cur_node) = true;
+        const size_t cur_node = queue.top().second;
+        queue.pop();
+        if (fix[cur_node])
+        {
+            continue;
+        }
+        fix[cur_node] = true;
 
-        for (const auto &e: _list.at(cur_node).adjacent)
+        for (const auto &e: _list[cur_node].adjacent)
         {
-            const edge &cur_edge = _edges.at(e);
+            const edge &cur_edge = _edges[e];
             if (!is_allowed(cur_edge, cur_node))
             {
                 continue;
             }
 
-            weight new_dist = distances.at(cur_node) + potential_cost(e, cur_edge.from != cur_node);
+            weight new_dist = distances[cur_node] + potential_cost(e, cur_edge.from != cur_node);
             size_t neighbour = other_endpoint(e, cur_node);
 
-            if (!fix.at(neighbour) && new_dist < distances.at(neighbour))
-            {
-                distances.at(neighbour) = new_dist;
-                prev_edges.at(neighbour) = e;
-            }
-        }
-
-        cur_node = _invalid_index;
-
-        for (size_t i = 0; i < distances.size(); ++i)
-        {
-            if (!fix.at(i) && (cur_node == _invalid_index || distances.at(i) < distances.at(cur_node)))
+            if (!fix[neighbour] && new_dist < distances[neighbour])
             {
-                cur_node = i;
+                distances[neighbour] = new_dist;
+                prev_edges[neighbour] = e;
+                queue.emplace(new_dist, neighbour);
             }
         }
     }
@@ -155,6 +157,11 @@ bool graph::compute_starting_potential()
             }
         }
 
+        // The potentials are final once a round changes nothing
+        if (!changed)
+        {
+            break;
+        }
     }
 
     return !changed;
@@ -174,12 +181,9 @@ weight graph::place()
                 base = _potential.at(n.index);
                 break;
             case node_type::rect_node:
-            {
-                rectangle &rect = _pack.get_rect(n.object_index);
-                rect.base.coord(_dim) = base - _potential.at(n.index);
-                rect.base.set = true;
+                (_dim == dimension::x ? _placement.x : _placement.y)[(size_t) n.object_index]
+                        = base - _potential.at(n.index);
                 break;
-            }
             case node_type::net_lower_node:
                 ret += _potential.at(n.index) * _pack.get_net((size_t) n.object_index).net_weight;
                 break;
@@ -192,9 +196,17 @@ weight graph::place()
     return ret;
 }
 
-graph graph::make_graph(packing &pack, dimension dim, sequence_pair sp)
+graph graph::make_graph(const packing &pack, rect_store &placement, dimension dim, const sequence_pair &sp)
 {
-    graph ret(pack, dim);
+    return dim == dimension::x ? make_graph<dimension::x>(pack, placement, sp)
+                               : make_graph<dimension::y>(pack, placement, sp);
+}
+
+template<dimension dim>
+graph graph::make_graph(const packing &pack, rect_store &placement, const sequence_pair &sp)
+{
+    graph ret(pack, placement, dim);
+    const csr_netlist &netlist = pack.get_netlist();
 
     ret._list.reserve(2 + pack.get_num_rects() + 2 * pack.get_num_nets());
 
@@ -202,33 +214,32 @@ graph graph::make_graph(packing &pack, dimension dim, sequence_pair sp)
 
     for (size_t i = 0; i < pack.get_num_nets(); ++i)
     {
-        for (auto p: pack.get_net(i).pin_list)
+        const net &n = pack.get_net(i);
+        for (size_t j = 0; j < n.pin_list.size(); ++j)
         {
-            ret.add_pin_edges(p, i);
+            // The offsets in the orientations of the placement, not the ones of the rectangles of pack
+            const pin &p = n.pin_list[j];
+            const uint8_t orientation = p.index < 0 ? 0 : placement.orientation[(size_t) p.index];
+            const point offset = netlist.relative_position(netlist.net_begin(i) + j, orientation);
+            ret.add_pin_edges<dim>(p, i, offset.coord<dim>());
         }
     }
 
-    std::vector<bool> smaller_neg_locus(pack.get_num_rects(), false);
-
-    for (auto it = sp.negative_locus.begin(); it != sp.negative_locus.end(); ++it)
+    for (const size_t rect_index : sp.negative_locus)
     {
-        ret.add_bound_edges(pack.get_rect((int) *it));
+        ret.add_bound_edges<dim>(rect_index);
 
-        switch (dim)
+        const size_t position = sp.positive_locus.position(rect_index);
+        if (dim == dimension::x)
         {
-            case dimension::x:
-            {
-                ret.add_all_orientations(*it, sp.positive_locus.begin(), sp.positive_locus.end(), smaller_neg_locus);
-                break;
-            }
-            case dimension::y:
-            {
-                ret.add_all_orientations(*it, sp.positive_locus.rbegin(), sp.positive_locus.rend(), smaller_neg_locus);
-                break;
-            }
+            ret.add_all_orientations<dim>(rect_index, sp.positive_locus.rend() - position,
+                                          sp.positive_locus.rend(), sp.negative_locus);
+        }
+        else
+        {
+            ret.add_all_orientations<dim>(rect_index, sp.positive_locus.begin() + position + 1,
+                                          sp.positive_locus.end(), sp.negative_locus);
         }
-
-        smaller_neg_locus.at(*it) = true;
     }
 
     return ret;
@@ -264,26 +275,35 @@ size_t graph::get_node_index(node_type type, size_t index) const
     }
 }
 
-void graph::add_bound_edges(const rectangle &rect)
+template<dimension dim>
+void graph::add_bound_edges(size_t rect_index)
 {
-    size_t index = get_node_index(node_type::rect_node, (size_t) rect.id);
+    size_t index = get_node_index(node_type::rect_node, rect_index);
     size_t chip_base = get_node_index(node_type::chip_base);
-    add_arc(chip_base, index, _pack.get_chip_base().get_pos(_dim));
-    add_arc(index, chip_base, rect.get_dimension(_dim) - _pack.get_chip_base().get_max(_dim));
+    add_arc(chip_base, index, _pack.get_chip_base().get_pos<dim>());
+    add_arc(index, chip_base, _placement.extent(dim)[rect_index] - _pack.get_chip_base().get_max<dim>());
 }
 
-void graph::add_pin_edges(const pin &p, size_t net_id)
+template<dimension dim>
+void graph::add_pin_edges(const pin &p, size_t net_id, pos rel_pin_pos)
 {
-    pos rel_pin_pos = _pack.get_rect(p.index).get_relative_pin_position(p, _dim);
     size_t pin_index = get_node_index(node_type::rect_node, (size_t) p.index);
+
+    // The chip base node stands for the origin, but fixed pins are relative to the base point of the chip base
+    if (p.index < 0)
+    {
+        rel_pin_pos += _pack.get_chip_base().get_pos<dim>();
+    }
+
     add_arc(get_node_index(node_type::net_lower_node, net_id), pin_index, -rel_pin_pos);
     add_arc(pin_index, get_node_index(node_type::net_upper_node, net_id), rel_pin_pos);
 }
 
+template<dimension dim>
 void graph::add_orientation_edges(size_t smaller, size_t bigger)
 {
     add_arc(get_node_index(node_type::rect_node, smaller), get_node_index(node_type::rect_node, bigger),
-            _pack.get_rect((int) smaller).get_dimension(_dim));
+            _placement.extent(dim)[smaller]);
 }
 
 std::ostream &operator<<(std::ostream &out, const graph &g)
@@ -386,24 +406,23 @@ void graph::add_all_nodes()
     }
 }
 
-template<class Iterator>
+template<dimension dim, class Iterator>
 void graph::add_all_orientations(size_t rect_index, const Iterator &begin, const Iterator &end,
-                                 const std::vector<bool> &smaller_negative_locus)
+                                 const locus &negative_locus)
 {
+    // One behind the largest position in the negative locus of a smaller rectangle seen so far. The rectangles before
+    // it in the negative locus are smaller than that rectangle, so they need no edge of their own.
+    size_t closest = 0;
+    const size_t limit = negative_locus.position(rect_index);
     for (auto it = begin; it != end; ++it)
     {
-        if (*it == rect_index)
-        {
-            return;
-        }
-        if (smaller_negative_locus.at(*it))
+        const size_t negative_position = negative_locus.position(*it);
+        if (negative_position < limit && negative_position >= closest)
         {
-            add_orientation_edges(rect_index, *it);
+            add_orientation_edges<dim>(*it, rect_index);
+            closest = negative_position + 1;
         }
     }
-
-    throw std::runtime_error(
-            "The rectangle " + std::to_string(rect_index) + " is missing from the postive locus of the sequence pair.");
 }
 
 size_t edge::other_endpoint(size_t first) const
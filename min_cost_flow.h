@@ -8,6 +8,7 @@
 #include <algorithm> //min_element
 #include "packing.h"
 #include "common.h"
+#include "rect_store.h"
 
 static constexpr size_t _invalid_index = std::numeric_limits<size_t>::max();
 static constexpr weight _invalid_cost = std::numeric_limits<weight>::max();
@@ -120,25 +121,28 @@ using path = std::list<edge_id>;
 
 class packing;
 class sequence_pair;
+class locus;
 
 class graph
 {
     friend std::ostream &operator<<(std::ostream &out, const graph &g);
 
 public:
-    graph(packing &pack_, const dimension dim_) :
+    graph(const packing &pack_, rect_store &placement_, const dimension dim_) :
             _pack(pack_),
+            _placement(placement_),
             _dim(dim_)
     {}
 
     /**
      * Computes the graph corresponding to the given pack.
-     * @param pack The pack from which to obtain the rectangle and nets
+     * @param pack The pack from which to obtain the chip base and nets, it is only read.
+     * @param placement The orientations and extents of the rectangles, place writes the coordinates into it.
      * @param dim The dimension which should be used
      * @param sp The sequence pair from which to obtain the orientation information.
      * @return The corresponding graph
      */
-    static graph make_graph(packing &pack, dimension dim, sequence_pair sp);
+    static graph make_graph(const packing &pack, rect_store &placement, dimension dim, const sequence_pair &sp);
 
     /**
      * Tries to compute a minimum flow on the graph. If there is circle of negative weight, the flow problem would be
@@ -148,7 +152,7 @@ public:
     bool compute_min_flow();
 
     /**
-     * Places the rectangle of _pack according to the current _potential.
+     * Places the rectangles in _placement according to the current _potential.
      */
     weight place();
 
@@ -194,25 +198,35 @@ private:
      */
     void add_arc(node_id from, node_id to, weight cost, weight cap = _invalid_cost);
 
+    /**
+     * make_graph for a dimension known at compile time, so the loops below do not switch on _dim.
+     */
+    template<dimension dim>
+    static graph make_graph(const packing &pack, rect_store &placement, const sequence_pair &sp);
+
     /**
      * Adds the edges which represent the constraint that the rectangle has to lay in the chip base.
-     * @param rect The rectangle for which to add the edges.
+     * @param rect_index The index of the rectangle for which to add the edges.
      */
-    void add_bound_edges(const rectangle &rect);
+    template<dimension dim>
+    void add_bound_edges(size_t rect_index);
 
     /**
      * Adds the edges which represent the constraint that the pin has to lay between the lower and upper bounds of a
      * net to which it belongs. This has to be called for all nets to which the pin belongs.
      * @param p The pin for which to add the edges
      * @param net_id The id of one net to which the pin belongs.
+     * @param rel_pin_pos The position of the pin relative to its rectangle in dimension dim.
      */
-    void add_pin_edges(const pin &p, size_t net_id);
+    template<dimension dim>
+    void add_pin_edges(const pin &p, size_t net_id, pos rel_pin_pos);
 
     /**
      * Adds the edges which represent the constraint that one rectangle lies to a side of another.
      * @param smaller The id of the rectangle on the left/below
      * @param bigger The id of the rectangle on the right/above
      */
+    template<dimension dim>
     void add_orientation_edges(size_t smaller, size_t bigger);
 
     /**
@@ -261,24 +275,26 @@ private:
     void add_all_nodes();
 
     /**
-     * Adds all orientation edges which contain rect_index as smaller rectangle.
+     * Adds the orientation edges which contain rect_index as bigger rectangle. Only the direct neighbours get an edge:
+     * if a rectangle lies between the smaller and rect_index in both loci, the constraint follows from its edges. So
+     * the rectangles have to come closest to rect_index first.
      * @tparam Iterator Depending on the dimension we need to call this on the postivie locus of our sequence pair
      * in different directions. This seemed like a not too terribly hacky way to make this work with forward and reverse
      * iterators.
-     * @param rect_index The rectangle which is the smaller for all orientation edges.
-     * @param begin The beginning of the positive locus.
-     * @param end The end of the positive. We should not reach it but it seems better to check this.
-     * @param smaller_negative_locus Is true at index i iff the rectangle with index i is left of rect_index in the
-     * negative locus.
+     * @param rect_index The rectangle which is the bigger for all orientation edges.
+     * @param begin The neighbour of rect_index in the positive locus.
+     * @param end The end of the positive locus in this direction.
+     * @param negative_locus The negative locus, only rectangles before rect_index in it get an edge.
      */
-    template<class Iterator>
+    template<dimension dim, class Iterator>
     void add_all_orientations(size_t rect_index, const Iterator &begin, const Iterator &end,
-                              const std::vector<bool> &smaller_negative_locus);
+                              const locus &negative_locus);
 
     adjlist _list;
     std::vector<edge> _edges;
     std::vector<weight> _potential;
-    packing &_pack;
+    const packing &_pack;
+    rect_store &_placement;
     const dimension _dim;
 };
 
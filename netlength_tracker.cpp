@@ -0,0 +1,254 @@
+#include "netlength_tracker.h"
+
+void netlength_tracker::extent::reset(pos value)
+{
+    min = value;
+    max = value;
+    min_count = 1;
+    max_count = 1;
+}
+
+void netlength_tracker::extent::add(pos value)
+{
+    if (value > max)
+    {
+        max = value;
+        max_count = 1;
+    }
+    else if (value == max)
+    {
+        ++max_count;
+    }
+
+    if (value < min)
+    {
+        min = value;
+        min_count = 1;
+    }
+    else if (value == min)
+    {
+        ++min_count;
+    }
+}
+
+bool netlength_tracker::extent::move(pos old_value, pos new_value)
+{
+    if (old_value == new_value)
+    {
+        return true;
+    }
+
+    // A border which lost its last pin stays where it is until the new value is added, so that value is compared
+    // against the old border, which is still a valid bound for all other pins
+    if (old_value == max)
+    {
+        --max_count;
+    }
+    if (old_value == min)
+    {
+        --min_count;
+    }
+
+    if (new_value > max)
+    {
+        max = new_value;
+        max_count = 1;
+    }
+    else if (new_value == max)
+    {
+        ++max_count;
+    }
+
+    if (new_value < min)
+    {
+        min = new_value;
+        min_count = 1;
+    }
+    else if (new_value == min)
+    {
+        ++min_count;
+    }
+
+    return min_count > 0 && max_count > 0;
+}
+
+netlength_tracker::netlength_tracker(const packing &pack) :
+        _pack(pack)
+{
+    const csr_netlist &netlist = _pack.get_netlist();
+    const size_t num_rects = _pack.get_num_rects();
+
+    _pin_net.resize(netlist.num_pins());
+    for (size_t i = 0; i < netlist.num_nets(); ++i)
+    {
+        for (size_t k = netlist.net_begin(i); k < netlist.net_end(i); ++k)
+        {
+            _pin_net[k] = i;
+        }
+    }
+
+    // Counting sort of the pins by their rectangle
+    _rect_pin_begin.assign(num_rects + 1, 0);
+    for (size_t k = 0; k < netlist.num_pins(); ++k)
+    {
+        if (netlist.pin_rect(k) < num_rects)
+        {
+            ++_rect_pin_begin[netlist.pin_rect(k) + 1];
+        }
+    }
+    for (size_t r = 0; r < num_rects; ++r)
+    {
+        _rect_pin_begin[r + 1] += _rect_pin_begin[r];
+    }
+
+    _rect_pins.resize(_rect_pin_begin.back());
+    std::vector<size_t> next(_rect_pin_begin.begin(), _rect_pin_begin.end() - 1);
+    for (size_t k = 0; k < netlist.num_pins(); ++k)
+    {
+        if (netlist.pin_rect(k) < num_rects)
+        {
+            _rect_pins[next[netlist.pin_rect(k)]++] = k;
+        }
+    }
+
+    reset();
+}
+
+void netlength_tracker::reset()
+{
+    const csr_netlist &netlist = _pack.get_netlist();
+    const rect_store &store = _pack.get_rect_store();
+    const point &chip_base = _pack.get_chip_base().base;
+
+    _pin_x.resize(netlist.num_pins());
+    _pin_y.resize(netlist.num_pins());
+    for (size_t k = 0; k < netlist.num_pins(); ++k)
+    {
+        const uint32_t rect = netlist.pin_rect(k);
+        if (rect < store.x.size())
+        {
+            const point offset = netlist.relative_position(k, store.orientation[rect]);
+            _pin_x[k] = store.x[rect] + offset.x;
+            _pin_y[k] = store.y[rect] + offset.y;
+        }
+        else
+        {
+            const point offset = netlist.relative_position(k, 0);
+            _pin_x[k] = chip_base.x + offset.x;
+            _pin_y[k] = chip_base.y + offset.y;
+        }
+    }
+
+    _boxes.resize(netlist.num_nets());
+    _netlength = 0;
+    for (size_t i = 0; i < netlist.num_nets(); ++i)
+    {
+        if (netlist.net_begin(i) == netlist.net_end(i))
+        {
+            continue;
+        }
+        recompute_box(i);
+        _netlength += netlist.net_weight(i) * _boxes[i].half_circumference();
+    }
+
+    _in_transaction = false;
+    _pin_journal.clear();
+    _net_journal.clear();
+}
+
+void netlength_tracker::recompute_box(size_t net_index)
+{
+    const csr_netlist &netlist = _pack.get_netlist();
+    const size_t begin = netlist.net_begin(net_index);
+    const size_t end = netlist.net_end(net_index);
+
+    net_box &box = _boxes[net_index];
+    box.x.reset(_pin_x[begin]);
+    box.y.reset(_pin_y[begin]);
+    for (size_t k = begin + 1; k < end; ++k)
+    {
+        box.x.add(_pin_x[k]);
+        box.y.add(_pin_y[k]);
+    }
+}
+
+int64_t netlength_tracker::get_netlength() const
+{
+    return _netlength;
+}
+
+void netlength_tracker::begin()
+{
+    _in_transaction = true;
+    _saved_netlength = _netlength;
+    _pin_journal.clear();
+    _net_journal.clear();
+}
+
+void netlength_tracker::update(size_t rect_index)
+{
+    const csr_netlist &netlist = _pack.get_netlist();
+    const rect_store &store = _pack.get_rect_store();
+    const uint8_t orientation = store.orientation[rect_index];
+
+    for (size_t i = _rect_pin_begin[rect_index]; i < _rect_pin_begin[rect_index + 1]; ++i)
+    {
+        const size_t k = _rect_pins[i];
+        const point offset = netlist.relative_position(k, orientation);
+        const pos x = store.x[rect_index] + offset.x;
+        const pos y = store.y[rect_index] + offset.y;
+        if (x == _pin_x[k] && y == _pin_y[k])
+        {
+            continue;
+        }
+
+        const size_t net_index = _pin_net[k];
+        net_box &box = _boxes[net_index];
+        if (_in_transaction)
+        {
+            _pin_journal.push_back(pin_change{k, _pin_x[k], _pin_y[k]});
+            _net_journal.push_back(net_change{net_index, box});
+        }
+
+        const weight w = netlist.net_weight(net_index);
+        _netlength -= w * box.half_circumference();
+
+        // Both have to be moved, so no short circuit here
+        const bool x_valid = box.x.move(_pin_x[k], x);
+        const bool y_valid = box.y.move(_pin_y[k], y);
+        _pin_x[k] = x;
+        _pin_y[k] = y;
+        if (!x_valid || !y_valid)
+        {
+            recompute_box(net_index);
+        }
+
+        _netlength += w * box.half_circumference();
+    }
+}
+
+void netlength_tracker::commit()
+{
+    _in_transaction = false;
+    _pin_journal.clear();
+    _net_journal.clear();
+}
+
+void netlength_tracker::rollback()
+{
+    assert(_in_transaction);
+
+    // Going backwards, the value saved first for every pin and net is restored last
+    for (auto it = _pin_journal.rbegin(); it != _pin_journal.rend(); ++it)
+    {
+        _pin_x[it->pin] = it->x;
+        _pin_y[it->pin] = it->y;
+    }
+    for (auto it = _net_journal.rbegin(); it != _net_journal.rend(); ++it)
+    {
+        _boxes[it->net] = it->box;
+    }
+    _netlength = _saved_netlength;
+
+    commit();
+}
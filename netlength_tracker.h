@@ -0,0 +1,137 @@
+#ifndef NETLENGTH_TRACKER_H
+#define NETLENGTH_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "common.h"
+#include "packing.h"
+
+/**
+ * Keeps the netlength of a packing up to date while a few rectangles at a time are moved, rotated or flipped. Every
+ * pin knows its last absolute position and every net its bounding box together with the number of pins on each side
+ * of the box. Updating a rectangle only touches its own pins: a side of a box is recomputed from the cached pins of
+ * the net only if the last pin on it moved inwards, so an update costs O(pins of the rectangle) mostly and
+ * O(pins of its nets) at worst.
+ *
+ * Changes between begin() and rollback() are journaled, so a rejected move is undone in time proportional to its
+ * updates. The tracker refers to the packing, reading another instance into the packing invalidates it.
+ */
+class netlength_tracker
+{
+private:
+    // The extent of a net in one dimension and how many pins lie on its borders
+    struct extent
+    {
+        pos min;
+        pos max;
+        uint32_t min_count;
+        uint32_t max_count;
+
+        /**
+         * Starts the extent with a single coordinate.
+         */
+        void reset(pos value);
+
+        /**
+         * Adds a coordinate of another pin.
+         */
+        void add(pos value);
+
+        /**
+         * Replaces the coordinate of a pin.
+         * @return False if a border lost its last pin, then the extent has to be recomputed.
+         */
+        bool move(pos old_value, pos new_value);
+    };
+
+    struct net_box
+    {
+        extent x;
+        extent y;
+
+        int64_t half_circumference() const
+        {
+            return (int64_t) x.max - x.min + (int64_t) y.max - y.min;
+        }
+    };
+
+    struct pin_change
+    {
+        size_t pin;
+        pos x;
+        pos y;
+    };
+
+    struct net_change
+    {
+        size_t net;
+        net_box box;
+    };
+
+    const packing &_pack;
+
+    // The pins of rectangle r are _rect_pins[_rect_pin_begin[r], _rect_pin_begin[r + 1]), fixed pins do not occur
+    std::vector<size_t> _rect_pin_begin;
+    std::vector<size_t> _rect_pins;
+    std::vector<size_t> _pin_net;
+
+    std::vector<pos> _pin_x;
+    std::vector<pos> _pin_y;
+    std::vector<net_box> _boxes;
+    int64_t _netlength = 0;
+
+    bool _in_transaction = false;
+    int64_t _saved_netlength = 0;
+    std::vector<pin_change> _pin_journal;
+    std::vector<net_change> _net_journal;
+
+    /**
+     * Computes the bounding box of a net from the cached pin positions.
+     * @param net_index The index of a net with at least one pin.
+     */
+    void recompute_box(size_t net_index);
+
+public:
+    /**
+     * Builds the reverse index and computes the netlength of the current packing.
+     * @param pack The packing to track, it has to outlive the tracker.
+     */
+    explicit netlength_tracker(const packing &pack);
+
+    /**
+     * Recomputes everything from the packing, e.g. after many rectangles were changed. Ends a running transaction
+     * without rollback.
+     */
+    void reset();
+
+    /**
+     * Returns the current netlength.
+     * @return The same as packing::compute_netlength, but with 64 bits.
+     */
+    int64_t get_netlength() const;
+
+    /**
+     * Starts recording changes, so they can be undone by rollback.
+     */
+    void begin();
+
+    /**
+     * Reads the current position and orientation of a rectangle from the packing and updates its nets. Call this
+     * after every change of a rectangle.
+     * @param rect_index The index of the changed rectangle.
+     */
+    void update(size_t rect_index);
+
+    /**
+     * Keeps the changes since begin.
+     */
+    void commit();
+
+    /**
+     * Restores the state from the call of begin. Restoring the rectangles of the packing is up to the caller.
+     */
+    void rollback();
+};
+
+#endif // NETLENGTH_TRACKER_H
@@ -0,0 +1,121 @@
+#include "netlist.h"
+
+#include <algorithm>
+#include <numeric>
+#include "parallel.h"
+
+// Netlists with fewer pins per thread are evaluated on fewer threads
+static constexpr size_t MIN_PINS_PER_THREAD = 1 << 14;
+
+void csr_netlist::build(const std::vector<net> &nets, const std::vector<rectangle> &rects,
+                        const rectangle &chip_base)
+{
+    _net_begin.resize(nets.size() + 1);
+    _net_weight.resize(nets.size());
+    size_t num_pins = 0;
+    for (size_t i = 0; i < nets.size(); ++i)
+    {
+        _net_begin[i] = num_pins;
+        _net_weight[i] = nets[i].net_weight;
+        num_pins += nets[i].pin_list.size();
+    }
+    _net_begin.back() = num_pins;
+
+    _pin_rect.resize(num_pins);
+    _offsets.resize(8 * num_pins);
+    size_t k = 0;
+    for (auto &n : nets)
+    {
+        for (auto &p : n.pin_list)
+        {
+            _pin_rect[k] = p.index < 0 ? (uint32_t) rects.size() : (uint32_t) p.index;
+
+            rectangle rect = p.index < 0 ? chip_base : rects[(size_t) p.index];
+            for (size_t orientation = 0; orientation < 8; ++orientation)
+            {
+                rect.rot = static_cast<rotation>(orientation & 3);
+                rect.flipped = (orientation & 4) != 0;
+                const point offset = rect.get_relative_pin_position(p);
+                _offsets[orientation * num_pins + k] = make_lanes(offset.x, offset.y);
+            }
+            ++k;
+        }
+    }
+}
+
+void csr_netlist::prepare(const rect_store &store, const point &chip_base, scratch &space) const
+{
+    const size_t num_rects = store.x.size();
+    space.base.resize(num_rects + 1);
+    space.table.resize(num_rects + 1);
+    for (size_t i = 0; i < num_rects; ++i)
+    {
+        space.base[i] = make_lanes(store.x[i], store.y[i]);
+        space.table[i] = store.orientation[i] * num_pins();
+    }
+    space.base[num_rects] = make_lanes(chip_base.x, chip_base.y);
+    space.table[num_rects] = 0;
+}
+
+int64_t csr_netlist::sum_nets(size_t first_net, size_t end_net, const scratch &space) const
+{
+    const std::vector<lanes> &base = space.base;
+    const std::vector<size_t> &table = space.table;
+
+    int64_t total = 0;
+    for (size_t net_index = first_net; net_index < end_net; ++net_index)
+    {
+        const size_t begin = _net_begin[net_index];
+        const size_t end = _net_begin[net_index + 1];
+        if (begin == end)
+        {
+            continue;
+        }
+
+        uint32_t rect = _pin_rect[begin];
+        lanes extreme = base[rect] + _offsets[table[rect] + begin];
+        for (size_t k = begin + 1; k < end; ++k)
+        {
+            rect = _pin_rect[k];
+            const lanes pin_position = base[rect] + _offsets[table[rect] + k];
+            extreme = extreme > pin_position ? extreme : pin_position;
+        }
+
+        const int64_t half_circumference = (int64_t) extreme[0] + extreme[1] + extreme[2] + extreme[3];
+        total += _net_weight[net_index] * half_circumference;
+    }
+    return total;
+}
+
+int64_t csr_netlist::compute_hpwl(const rect_store &store, const point &chip_base, unsigned num_threads) const
+{
+    prepare(store, chip_base, _scratch);
+
+    num_threads = (unsigned) std::min<size_t>(num_threads, num_pins() / MIN_PINS_PER_THREAD + 1);
+    if (num_threads <= 1)
+    {
+        return sum_nets(0, num_nets(), _scratch);
+    }
+
+    // Chunk t starts with the first net beginning at or behind pin t * num_pins / num_threads
+    std::vector<size_t> borders(num_threads + 1, num_nets());
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        borders[t] = (size_t) (std::lower_bound(_net_begin.begin(), _net_begin.end() - 1,
+                                                t * num_pins() / num_threads) - _net_begin.begin());
+    }
+
+    std::vector<int64_t> partial_sums(num_threads);
+    run_in_parallel(num_threads, [&](size_t t)
+    {
+        partial_sums[t] = sum_nets(borders[t], borders[t + 1], _scratch);
+    });
+
+    return std::accumulate(partial_sums.begin(), partial_sums.end(), (int64_t) 0);
+}
+
+int64_t csr_netlist::compute_hpwl(const rect_store &store, const point &chip_base, scratch &space) const
+{
+    prepare(store, chip_base, space);
+    return sum_nets(0, num_nets(), space);
+}
@@ -0,0 +1,166 @@
+#ifndef NETLIST_H
+#define NETLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "common.h"
+#include "rectangle.h"
+#include "net.h"
+#include "rect_store.h"
+
+/**
+ * The nets of a packing in compressed sparse row format, built once when the nets are loaded. The pins of net i are
+ * numbered net_begin[i] to net_begin[i + 1] - 1 in the order of its pin list. Every pin knows the index of its
+ * rectangle and its offset from the base point of the rectangle in all 8 orientations, so the netlength of a packing
+ * only needs the base points and orientations from a rect_store.
+ */
+class csr_netlist
+{
+public:
+    // {x, y, -x, -y} of one point. The maximum over all pins of a net is {x_max, y_max, -x_min, -y_min}, so one
+    // vector maximum per pin handles both dimensions and the sum of the lanes is the half circumference.
+    typedef int32_t lanes __attribute__((vector_size(16)));
+
+    /**
+     * Scratch space for compute_hpwl: the base point of every rectangle and of the chip base behind them, and the
+     * first entry of _offsets for the orientation of the rectangle. Threads evaluating the same netlist need their own.
+     */
+    struct scratch
+    {
+        std::vector<lanes> base;
+        std::vector<size_t> table;
+    };
+
+private:
+    std::vector<size_t> _net_begin;
+    std::vector<weight> _net_weight;
+
+    // The rectangle of every pin, fixed pins get the number of rectangles, i.e. the slot behind the last rectangle
+    std::vector<uint32_t> _pin_rect;
+
+    // The offset of pin k in orientation o (the one from rect_store) is at o * num_pins + k. Most rectangles share a
+    // few orientations, so this keeps the lookups of one evaluation in a few sequential streams.
+    std::vector<lanes> _offsets;
+
+    // The scratch space of compute_hpwl without one of its own
+    mutable scratch _scratch;
+
+    static lanes make_lanes(pos x, pos y)
+    {
+        return lanes{x, y, -x, -y};
+    }
+
+    /**
+     * Fills the scratch space with the current rectangles.
+     */
+    void prepare(const rect_store &store, const point &chip_base, scratch &space) const;
+
+    /**
+     * Sums up the weighted half circumferences of the nets first_net to end_net - 1, prepare has to be called first.
+     */
+    int64_t sum_nets(size_t first_net, size_t end_net, const scratch &space) const;
+
+public:
+    /**
+     * Builds the netlist.
+     * @param nets The nets of the packing.
+     * @param rects The rectangles of the packing, only their sizes are used.
+     * @param chip_base The chip base, used for the fixed pins.
+     */
+    void build(const std::vector<net> &nets, const std::vector<rectangle> &rects, const rectangle &chip_base);
+
+    /**
+     * Returns the total number of pins.
+     * @return The size of the pin arrays.
+     */
+    size_t num_pins() const
+    {
+        return _pin_rect.size();
+    }
+
+    /**
+     * Returns the number of the first pin of a net.
+     * @param net_index The index of the net.
+     * @return net_begin[net_index]
+     */
+    size_t net_begin(size_t net_index) const
+    {
+        return _net_begin[net_index];
+    }
+
+    /**
+     * Returns the number behind the last pin of a net.
+     * @param net_index The index of the net.
+     * @return net_begin[net_index + 1]
+     */
+    size_t net_end(size_t net_index) const
+    {
+        return _net_begin[net_index + 1];
+    }
+
+    /**
+     * Returns the number of nets.
+     * @return The number of nets given to build.
+     */
+    size_t num_nets() const
+    {
+        return _net_weight.size();
+    }
+
+    /**
+     * Returns the weight of a net.
+     * @param net_index The index of the net.
+     * @return Its net_weight.
+     */
+    weight net_weight(size_t net_index) const
+    {
+        return _net_weight[net_index];
+    }
+
+    /**
+     * Returns the rectangle of a pin.
+     * @param pin The number of the pin.
+     * @return The index of the rectangle, the number of rectangles for a fixed pin.
+     */
+    uint32_t pin_rect(size_t pin) const
+    {
+        return _pin_rect[pin];
+    }
+
+    /**
+     * Looks up the position of a pin relative to the base point of its rectangle.
+     * @param pin The number of the pin.
+     * @param orientation The orientation of its rectangle, see rect_store.
+     * @return The offset of the pin.
+     */
+    point relative_position(size_t pin, uint8_t orientation) const
+    {
+        const lanes &offset = _offsets[orientation * num_pins() + pin];
+        return point(offset[0], offset[1], true);
+    }
+
+    /**
+     * Computes the weighted sum of the half circumferences of the bounding boxes of all nets. Nets without pins do
+     * not count. This uses scratch space of the netlist, so it must not be called for the same netlist from several
+     * threads at once.
+     * @param store The current rectangles.
+     * @param chip_base The base point of the chip base.
+     * @param num_threads The number of threads to use. The nets are cut into chunks with about the same number of
+     * pins, small netlists use fewer threads. The sum is exact, so the result does not depend on the chunks.
+     * @return The netlength, summed up with 64 bits.
+     */
+    int64_t compute_hpwl(const rect_store &store, const point &chip_base, unsigned num_threads = 1) const;
+
+    /**
+     * Computes the same as compute_hpwl on one thread with the given scratch space, so several threads can evaluate
+     * the same netlist at once.
+     * @param store The current rectangles.
+     * @param chip_base The base point of the chip base.
+     * @param space The scratch space of the calling thread.
+     * @return The netlength, summed up with 64 bits.
+     */
+    int64_t compute_hpwl(const rect_store &store, const point &chip_base, scratch &space) const;
+};
+
+#endif // NETLIST_H
@@ -1,15 +1,201 @@
 #include "packing.h"
 
+// Chunks smaller than this are not parsed on an own thread
+static constexpr size_t MIN_PARSE_CHUNK_SIZE = 1 << 18;
+
 bool rect_ind_compare::operator()(size_t first, size_t second) const
 {
     return elements[first] < elements[second];
 }
 
+namespace
+{
+    /**
+     * Builds a locus from insertions next to elements which are already in it, without moving any element. Every
+     * element remembers the elements inserted directly before and after it, the final order is an in-order traversal
+     * of this tree. Elements inserted before the same element end up in the order of insertion, elements inserted
+     * after it or at the front in reverse order, just as with repeated std::list::insert at the same place.
+     */
+    class locus_builder
+    {
+    private:
+        static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+        // The element n is a virtual root, its after list is the front of the locus
+        std::vector<size_t> _before_first;
+        std::vector<size_t> _before_last;
+        std::vector<size_t> _after_first;
+        std::vector<size_t> _next_sibling;
+
+    public:
+        explicit locus_builder(size_t n) :
+                _before_first(n + 1, none),
+                _before_last(n + 1, none),
+                _after_first(n + 1, none),
+                _next_sibling(n + 1, none)
+        {}
+
+        void push_front(size_t element)
+        {
+            insert_after(_next_sibling.size() - 1, element);
+        }
+
+        void insert_before(size_t anchor, size_t element)
+        {
+            if (_before_last[anchor] == none)
+            {
+                _before_first[anchor] = element;
+            }
+            else
+            {
+                _next_sibling[_before_last[anchor]] = element;
+            }
+            _before_last[anchor] = element;
+        }
+
+        void insert_after(size_t anchor, size_t element)
+        {
+            _next_sibling[element] = _after_first[anchor];
+            _after_first[anchor] = element;
+        }
+
+        locus build() const
+        {
+            const size_t root = _next_sibling.size() - 1;
+            locus result;
+
+            struct frame
+            {
+                size_t element;
+                size_t child;
+                bool after;
+            };
+            std::vector<frame> stack{{root, _before_first[root], false}};
+            while (!stack.empty())
+            {
+                frame &top = stack.back();
+                if (top.child != none)
+                {
+                    const size_t child = top.child;
+                    top.child = _next_sibling[child];
+                    stack.push_back(frame{child, _before_first[child], false});
+                }
+                else if (!top.after)
+                {
+                    if (top.element != root)
+                    {
+                        result.push_back(top.element);
+                    }
+                    top.child = _after_first[top.element];
+                    top.after = true;
+                }
+                else
+                {
+                    stack.pop_back();
+                }
+            }
+            return result;
+        }
+    };
+}
+
 sequence_pair packing::to_sequence_pair() const
 {
+    const size_t n = _rect_list.size();
+    locus_builder positive_locus(n), negative_locus(n);
+
+    std::vector<size_t> indices(n);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    // We want to sweep over the rectangles from left to right. This compares the same as rectangle::compare, so the
+    // result is the same as the one of to_sequence_pair_reference.
+    const std::vector<pos> &x = _store.x;
+    std::sort(indices.begin(), indices.end(), [&x](size_t first, size_t second)
+    {
+        return x[first] < x[second];
+    });
+
+    // The sweeping line is ordered from bottom to top like rect_ind_compare, i.e. by y and then by index, so it is a
+    // set of ranks in this order
+    const std::vector<uint32_t> by_y = radix_order(_store.y);
+    std::vector<size_t> y_rank(n);
+    for (size_t r = 0; r < n; ++r)
+    {
+        y_rank[by_y[r]] = r;
+    }
+    rank_set line(n);
+
+    // rectangle::contains_x and contains_y on _store
+    auto contains_x = [this](size_t index, pos x_coordinate)
+    {
+        return _store.x[index] <= x_coordinate && x_coordinate < _store.x[index] + _store.width[index];
+    };
+    auto contains_y = [this](size_t index, pos y_coordinate)
+    {
+        return _store.y[index] <= y_coordinate && y_coordinate < _store.y[index] + _store.height[index];
+    };
+
+    for (auto &i : indices)
+    {
+        const size_t rank = y_rank[i];
+        line.insert(rank);
+
+        // First we want to find the next rectangle below which is still active
+        const size_t below = rank == 0 ? rank_set::npos : line.predecessor(rank - 1);
+        if (below != rank_set::npos && contains_y(by_y[below], _store.y[i]))
+        {
+            // rec is before the previous in the sp
+            if (contains_x(by_y[below], _store.x[i]))
+            {
+                throw std::runtime_error("Packing is invalid, impossible to find sequence pair");
+            }
+            positive_locus.insert_before(by_y[below], i);
+            line.erase(below);
+        }
+        else if (below == rank_set::npos)
+        {
+            positive_locus.push_front(i);
+        }
+        else
+        {
+            positive_locus.insert_after(by_y[below], i);
+        }
+
+        // Since this does not intersect our rectangle we can go on to the rectangles above
+        size_t above = line.successor(rank + 1);
+        while (above != rank_set::npos && contains_y(i, _store.y[by_y[above]]))
+        {
+            if (contains_x(by_y[above], _store.x[i]))
+            {
+                throw std::runtime_error("Packing is invalid, impossible to find sequence pair");
+            }
+            line.erase(above);
+            above = line.successor(above + 1);
+        }
+
+        if (above == rank_set::npos)
+        {
+            negative_locus.push_front(i);
+        }
+        else
+        {
+            negative_locus.insert_after(by_y[above], i);
+        }
+        // So this rectangle does not intersect with one already there, therefore, we can go on
+    }
+
     sequence_pair seq_pair;
-    std::vector<std::list<size_t>::iterator> up_pos(_rect_list.size(), seq_pair.positive_locus.end());
-    std::vector<std::list<size_t>::iterator> down_pos(_rect_list.size(), seq_pair.negative_locus.end());
+    seq_pair.positive_locus = positive_locus.build();
+    seq_pair.negative_locus = negative_locus.build();
+    return seq_pair;
+}
+
+sequence_pair packing::to_sequence_pair_reference() const
+{
+    // The loci are built by inserting in the middle, so they are lists until the end
+    std::list<size_t> positive_locus, negative_locus;
+    std::vector<std::list<size_t>::iterator> up_pos(_rect_list.size(), positive_locus.end());
+    std::vector<std::list<size_t>::iterator> down_pos(_rect_list.size(), negative_locus.end());
 
     std::vector<size_t> indices(_rect_list.size());
     std::iota(indices.begin(), indices.end(), 0);
@@ -40,19 +226,19 @@ sequence_pair packing::to_sequence_pair() const
             {
                 throw std::runtime_error("Packing is invalid, impossible to find sequence pair");
             }
-            up_pos[i] = seq_pair.positive_locus.insert(up_pos[*std::prev(it)], i);
+            up_pos[i] = positive_locus.insert(up_pos[*std::prev(it)], i);
             line.erase(std::prev(it));
         }
         else
         {
             if (it == line.begin())
             {
-                seq_pair.positive_locus.push_front(i);
-                up_pos[i] = seq_pair.positive_locus.begin();
+                positive_locus.push_front(i);
+                up_pos[i] = positive_locus.begin();
             }
             else
             {
-                up_pos[i] = seq_pair.positive_locus.insert(std::next(up_pos[*std::prev(it)]), i);
+                up_pos[i] = positive_locus.insert(std::next(up_pos[*std::prev(it)]), i);
             }
         }
 
@@ -73,25 +259,199 @@ sequence_pair packing::to_sequence_pair() const
 
         if (it == line.end())
         {
-            down_pos[i] = seq_pair.negative_locus.insert(seq_pair.negative_locus.begin(), i);
+            down_pos[i] = negative_locus.insert(negative_locus.begin(), i);
         }
         else
         {
-            down_pos[i] = seq_pair.negative_locus.insert(std::next(down_pos[*it]), i);
+            down_pos[i] = negative_locus.insert(std::next(down_pos[*it]), i);
         }
         // So this rectangle does not intersect with one already there, therefore, we can go on
     }
+
+    sequence_pair seq_pair;
+    seq_pair.positive_locus = locus(positive_locus.begin(), positive_locus.end());
+    seq_pair.negative_locus = locus(negative_locus.begin(), negative_locus.end());
     return seq_pair;
 }
 
+void packing::non_empty_boxes(std::vector<bounds> &boxes, std::vector<int> &ids) const
+{
+    boxes.clear();
+    ids.clear();
+    boxes.reserve(_store.x.size());
+    ids.reserve(_store.x.size());
+
+    for (size_t i = 0; i < _store.x.size(); ++i)
+    {
+        if (_store.width[i] != 0 && _store.height[i] != 0)
+        {
+            bounds box;
+            box.x_min = _store.x[i];
+            box.x_max = _store.x[i] + _store.width[i];
+            box.y_min = _store.y[i];
+            box.y_max = _store.y[i] + _store.height[i];
+            boxes.push_back(box);
+            ids.push_back((int) i);
+        }
+    }
+}
+
+/**
+ * Sweeps from left to right over the left and right edges of the given rectangles and returns the first pair that
+ * intersects. The active rectangles all contain the current x coordinate, so as long as there is no collision their
+ * y intervals are disjoint and it suffices to check a new rectangle against its neighbours in y direction. The active
+ * rectangles are kept in a rank_set over their rank in y direction, which makes this O(n log n) in the worst case.
+ * @param boxes The rectangles to check, none of them may be empty.
+ * @param ids The ids of the rectangles, these are put into the certificate.
+ * @param stop If this becomes true, the sweep gives up and returns a valid certificate.
+ */
+static certificate sweep_overlaps(const std::vector<bounds> &boxes, const std::vector<int> &ids,
+                                  const std::atomic<bool> &stop)
+{
+    const size_t n = boxes.size();
+
+    // Radix sorting the coordinates is a lot faster than sorting indices with a comparator
+    auto sorted_by = [&boxes](pos bounds::*coordinate)
+    {
+        std::vector<int32_t> keys(boxes.size());
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            keys[i] = boxes[i].*coordinate;
+        }
+        return radix_order(keys);
+    };
+
+    const std::vector<uint32_t> by_y = sorted_by(&bounds::y_min);
+    std::vector<uint32_t> y_rank(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        y_rank[by_y[i]] = (uint32_t) i;
+    }
+
+    // The events: left edges insert a rectangle, right edges remove it
+    const std::vector<uint32_t> insertions = sorted_by(&bounds::x_min);
+    const std::vector<uint32_t> removals = sorted_by(&bounds::x_max);
+
+    rank_set active(n);
+    size_t next_removal = 0;
+
+    for (size_t step = 0; step < n; ++step)
+    {
+        // Checking the flag on every step would be a waste
+        if (step % 1024 == 0 && stop.load(std::memory_order_relaxed))
+        {
+            return certificate();
+        }
+
+        const uint32_t i = insertions[step];
+        const bounds &box = boxes[i];
+
+        // The right edge does not belong to the rectangle, so we remove before we insert on the same coordinate
+        while (next_removal < n && boxes[removals[next_removal]].x_max <= box.x_min)
+        {
+            active.erase(y_rank[removals[next_removal]]);
+            ++next_removal;
+        }
+
+        const size_t below = active.predecessor(y_rank[i]);
+        if (below != rank_set::npos && boxes[by_y[below]].y_max > box.y_min)
+        {
+            return certificate(ids[i], ids[by_y[below]]);
+        }
+
+        const size_t above = active.successor(y_rank[i]);
+        if (above != rank_set::npos && boxes[by_y[above]].y_min < box.y_max)
+        {
+            return certificate(ids[i], ids[by_y[above]]);
+        }
+
+        active.insert(y_rank[i]);
+    }
+
+    return certificate();
+}
+
 /**
 * Determines wether the placement contains a collision (and thus is invalid).
-* Gives the indices of two colliding rectangles as an certificate or (-1, -1) 
+* Gives the indices of two colliding rectangles as an certificate or (-1, -1)
 * if there is no collision.
+*
+* For several threads the placement is cut into vertical strips with about the same number of rectangles. Every
+* rectangle is copied into all strips it overlaps and each strip is swept on its own. Two intersecting rectangles
+* share an inner point, and the strip containing it sees both of them.
 */
-const certificate packing::is_valid() const
+const certificate packing::is_valid(unsigned num_threads) const
 {
+    // Empty rectangles do not have an inner point and would break the disjointness of the active intervals
+    std::vector<bounds> boxes;
+    std::vector<int> ids;
+    non_empty_boxes(boxes, ids);
+
+    std::atomic<bool> stop(false);
+
+    if (num_threads <= 1 || boxes.size() < 2 * num_threads)
+    {
+        return sweep_overlaps(boxes, ids, stop);
+    }
+
+    // The strips start at the left edges of every (n / num_threads)-th rectangle from the left
+    std::vector<int32_t> left_edges(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        left_edges[i] = boxes[i].x_min;
+    }
+    const std::vector<uint32_t> by_x = radix_order(left_edges);
+
+    std::vector<pos> strip_begin;
+    for (size_t strip = 0; strip < num_threads; ++strip)
+    {
+        const pos border = boxes[by_x[strip * boxes.size() / num_threads]].x_min;
+        if (strip_begin.empty() || strip_begin.back() < border)
+        {
+            strip_begin.push_back(border);
+        }
+    }
+
+    const size_t num_strips = strip_begin.size();
+    std::vector<std::vector<bounds>> strip_boxes(num_strips);
+    std::vector<std::vector<int>> strip_ids(num_strips);
+
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        // The last strip starting left of our left edge, up to the last strip starting left of our right edge
+        auto first = std::upper_bound(strip_begin.begin(), strip_begin.end(), boxes[i].x_min) - 1;
+        auto last = std::lower_bound(strip_begin.begin(), strip_begin.end(), boxes[i].x_max);
+
+        for (auto strip = first; strip != last; ++strip)
+        {
+            strip_boxes[strip - strip_begin.begin()].push_back(boxes[i]);
+            strip_ids[strip - strip_begin.begin()].push_back(ids[i]);
+        }
+    }
+
+    std::vector<certificate> certificates(num_strips);
+    run_in_parallel(num_strips, [&](size_t strip)
+    {
+        certificates[strip] = sweep_overlaps(strip_boxes[strip], strip_ids[strip], stop);
+        if (!certificates[strip].valid)
+        {
+            stop = true;
+        }
+    });
 
+    for (auto &cert : certificates)
+    {
+        if (!cert.valid)
+        {
+            return cert;
+        }
+    }
+
+    return certificate();
+}
+
+const certificate packing::is_valid_reference() const
+{
     std::vector<size_t> indices(_rect_list.size());
     std::iota(indices.begin(), indices.end(), 0);
 
@@ -106,129 +466,621 @@ const certificate packing::is_valid() const
 
     for (auto i : indices)
     {
-        const rectangle & rec = get_rect(i);
+        const rectangle &rec = _rect_list[i];
         auto in = line.insert(i);
         assert(in.second);
 
         auto it = in.first;
 
-        // First we want to find the next rectangle below which is still active
-        while (it != line.begin() && !_rect_list.at(*std::prev(it)).contains_x(rec.base.x))
+        // First we want to find the next rectangle below which is still active
+        while (it != line.begin() && !_rect_list[*std::prev(it)].contains_x(rec.base.x))
+        {
+            line.erase(std::prev(it));
+        }
+
+        if (it != line.begin() && rec.intersects(_rect_list[*std::prev(it)]))
+        {
+            return certificate((int) i, (int) *std::prev(it));
+        }
+
+        it++;
+        // Since this does not intersect our rectangle we can go on to the rectangles above
+        while (it != line.end() && !_rect_list[*it].contains_x(rec.base.x))
+        {
+            // line.erase returns an iterator pointing on the element behind the deleted one
+            it = line.erase(it);
+        }
+
+        if (it != line.end() && _rect_list[*it].intersects(rec))
+        {
+            return certificate((int) i, (int) *it);
+        }
+        // So this rectangle does not intersect with one already there, therefore, we can go on
+    }
+
+    return certificate();
+}
+
+/**
+ * Reports every intersecting pair of rectangles exactly once. We sweep from left to right like in sweep_overlaps, but
+ * now the active y intervals may overlap. A new interval [y_min, y_max) intersects an active one iff the active one
+ * starts in [y_min, y_max) or contains y_min while starting below it. The first kind is found by walking through the
+ * active starts in a rank_set, the second one by a stabbing query in an interval_tree over the y coordinates. Both
+ * only touch what they report, so this takes O(n log n + k) for k intersecting pairs.
+ */
+void packing::report_overlaps(const std::function<void(const certificate &)> &report) const
+{
+    std::vector<bounds> boxes;
+    std::vector<int> ids;
+    non_empty_boxes(boxes, ids);
+
+    const size_t n = boxes.size();
+    std::vector<int32_t> keys(n);
+    auto sorted_by = [&boxes, &keys](pos bounds::*coordinate)
+    {
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            keys[i] = boxes[i].*coordinate;
+        }
+        return radix_order(keys);
+    };
+
+    // The rank of every rectangle by its lower edge, and the first rank with the same lower edge
+    const std::vector<uint32_t> by_y = sorted_by(&bounds::y_min);
+    std::vector<uint32_t> y_rank(n);
+    std::vector<uint32_t> first_rank(n);
+
+    // The queries only stab lower edges, so the distinct lower edges are the slabs of the interval tree
+    std::vector<pos> ys;
+    std::vector<size_t> first_slab(n);
+    for (size_t r = 0; r < n; ++r)
+    {
+        const uint32_t i = by_y[r];
+        y_rank[i] = (uint32_t) r;
+        if (ys.empty() || ys.back() != boxes[i].y_min)
+        {
+            ys.push_back(boxes[i].y_min);
+            first_rank[i] = (uint32_t) r;
+        }
+        else
+        {
+            first_rank[i] = first_rank[by_y[r - 1]];
+        }
+        first_slab[i] = ys.size() - 1;
+    }
+
+    std::vector<size_t> end_slab(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        end_slab[i] = (size_t) (std::lower_bound(ys.begin(), ys.end(), boxes[i].y_max) - ys.begin());
+    }
+
+    const std::vector<uint32_t> insertions = sorted_by(&bounds::x_min);
+    const std::vector<uint32_t> removals = sorted_by(&bounds::x_max);
+
+    rank_set active_starts(n);
+    interval_tree active_intervals(ys.size(), first_slab, std::move(end_slab));
+    size_t next_removal = 0;
+
+    for (const uint32_t i : insertions)
+    {
+        const bounds &box = boxes[i];
+
+        while (next_removal < n && boxes[removals[next_removal]].x_max <= box.x_min)
+        {
+            active_starts.erase(y_rank[removals[next_removal]]);
+            active_intervals.erase(removals[next_removal]);
+            ++next_removal;
+        }
+
+        for (size_t r = active_starts.successor(first_rank[i]);
+             r != rank_set::npos && boxes[by_y[r]].y_min < box.y_max;
+             r = active_starts.successor(r + 1))
+        {
+            report(certificate(ids[i], ids[by_y[r]]));
+        }
+
+        active_intervals.stab(first_slab[i], [&](uint32_t other)
+        {
+            // Intervals starting at y_min were already reported above
+            if (boxes[other].y_min < box.y_min)
+            {
+                report(certificate(ids[i], ids[other]));
+            }
+        });
+
+        active_starts.insert(y_rank[i]);
+        active_intervals.insert(i);
+    }
+}
+
+std::vector<certificate> packing::all_overlaps() const
+{
+    std::vector<certificate> certificates;
+    report_overlaps([&certificates](const certificate &cert)
+    {
+        certificates.push_back(cert);
+    });
+    return certificates;
+}
+
+std::ostream &operator<<(std::ostream &out, const packing &pack)
+{
+    for (auto &rect : pack._rect_list)
+    {
+        assert(pack._chip_base.get_pos(dimension::x) <= rect.get_pos(dimension::x));
+        assert(pack._chip_base.get_max(dimension::x) >= rect.get_max(dimension::x));
+        assert(pack._chip_base.get_pos(dimension::y) <= rect.get_max(dimension::y));
+        assert(pack._chip_base.get_max(dimension::y) >= rect.get_max(dimension::y));
+
+        out << rect << "\n";
+    }
+    return out;
+}
+
+/**
+ * Reads solution, i.e. a list of placed rectangles.
+ */
+void packing::read_sol_from(const std::string filename)
+{
+    auto file = std::make_shared<const mapped_file>(filename);
+
+    if (is_binary_file(file->begin(), file->end()))
+    {
+        read_binary(file, filename, binary_kind::solution);
+        return;
+    }
+
+    instance_scanner scanner(file->begin(), file->end());
+
+    size_t num_rects;
+    scanner.count_rectangles(num_rects);
+
+    _grid = grid_index();
+    _rect_list.clear();
+    _rect_list.reserve(num_rects);
+
+    rectangle rect;
+    while (scanner.read_rectangle(rect))
+    {
+        rect.id = _rect_list.size();
+        _rect_list.push_back(rect);
+    }
+    _store.assign(_rect_list);
+    _netlist_valid = false;
+}
+
+/**
+ *  Reads just the dimension from the instance file.
+ */
+void packing::read_dimension_from_inst(const std::string filename)
+{
+    _base_filename = filename;
+    std::ifstream file(filename);
+
+    if (!file)
+    {
+        throw std::runtime_error("File not " + filename + " not found.");
+    }
+
+    file >> _chip_base;
+}
+
+/**
+ * Checks that every pin is on the chip base or on a rectangle of the instance, the binary reader checks this itself.
+ */
+static void check_pin_indices(const std::vector<net> &net_list, size_t num_rects, const std::string &filename)
+{
+    for (auto &n : net_list)
+    {
+        for (auto &p : n.pin_list)
+        {
+            if (p.index >= 0 && (size_t) p.index >= num_rects)
+            {
+                throw std::runtime_error("File " + filename + " has invalid format.");
+            }
+        }
+    }
+}
+
+/**
+ * Parses the nets in [begin, end). The range is split at net borders and the chunks are parsed in parallel and then
+ * merged in order.
+ */
+static std::vector<net> parse_nets(const char *begin, const char *end, unsigned num_threads)
+{
+    const auto borders = instance_scanner::split_lines(begin, end, num_threads, 'N');
+    const size_t num_chunks = borders.size() - 1;
+
+    std::vector<std::vector<net>> chunks(num_chunks);
+
+    // A chunk is incomplete if parsing stopped before its end, then the sequential reader would have stopped there too
+    std::vector<char> complete(num_chunks, true);
+
+    run_in_parallel(num_chunks, [&](size_t chunk)
+    {
+        instance_scanner chunk_scanner(borders[chunk], borders[chunk + 1]);
+        net n;
+        while (chunk_scanner.read_net(n))
+        {
+            chunks[chunk].push_back(std::move(n));
+        }
+        complete[chunk] = chunk_scanner.at_end();
+    });
+
+    std::vector<net> net_list;
+    net_list.reserve(instance_scanner(begin, end).count_nets());
+
+    for (size_t i = 0; i < num_chunks; ++i)
+    {
+        for (auto &n : chunks[i])
+        {
+            n.index = net_list.size();
+            net_list.push_back(std::move(n));
+        }
+
+        if (!complete[i])
+        {
+            break;
+        }
+    }
+
+    return net_list;
+}
+
+/**
+ * Read an instance, i.e. size of the chip, a list of unplaced rectangles and blockages,
+ * and a list of nets. The file is mapped into memory and parsed in place. The rectangle section is split at line
+ * borders, the chunks are parsed in parallel and then merged in order. The nets are only parsed when they are used
+ * for the first time, so we just remember where they start.
+ */
+void packing::read_inst_from(const std::string filename, unsigned num_threads)
+{
+    auto file = std::make_shared<const mapped_file>(filename);
+    _base_filename = filename;
+
+    if (is_binary_file(file->begin(), file->end()))
+    {
+        read_binary(file, filename, binary_kind::instance);
+        return;
+    }
+
+    instance_scanner scanner(file->begin(), file->end());
+
+    if (!scanner.read_rectangle(_chip_base) || _chip_base.id != -1)
+    {
+        throw std::runtime_error("File " + filename + " has invalid format.");
+    }
+
+    size_t num_rects;
+    const char *net_section = scanner.count_rectangles(num_rects);
+    const char *rect_section = scanner.position();
+
+    if (num_threads == 0)
+    {
+        // Small files are not worth starting threads for
+        num_threads = (unsigned) std::min<size_t>(default_num_threads(), file->size() / MIN_PARSE_CHUNK_SIZE + 1);
+    }
+
+    const auto borders = instance_scanner::split_lines(rect_section, net_section, num_threads);
+    const size_t num_chunks = borders.size() - 1;
+
+    std::vector<std::vector<rectangle>> chunks(num_chunks);
+    std::vector<char> complete(num_chunks, true);
+
+    run_in_parallel(num_chunks, [&](size_t chunk)
+    {
+        instance_scanner chunk_scanner(borders[chunk], borders[chunk + 1]);
+        rectangle rect;
+        while (chunk_scanner.read_rectangle(rect))
+        {
+            if (!rect.blockage)
+            {
+                chunks[chunk].push_back(rect);
+            }
+            rect = rectangle();
+        }
+        complete[chunk] = chunk_scanner.at_end();
+    });
+
+    _grid = grid_index();
+    _rect_list.clear();
+    _rect_list.reserve(num_rects);
+
+    bool reached_nets = true;
+    for (size_t i = 0; i < num_chunks; ++i)
+    {
+        for (auto &rect : chunks[i])
+        {
+            rect.id = _rect_list.size();
+            _rect_list.push_back(rect);
+        }
+
+        if (!complete[i])
+        {
+            reached_nets = false;
+            break;
+        }
+    }
+    _store.assign(_rect_list);
+    _netlist_valid = false;
+
+    _net_list.clear();
+    _net_loader = nullptr;
+
+    if (reached_nets && net_section != file->end())
+    {
+        // The loader keeps the file mapped until the nets are parsed
+        const size_t num_rects = _rect_list.size();
+        _net_loader = [file, net_section, num_threads, num_rects, filename]()
+        {
+            std::vector<net> net_list = parse_nets(net_section, file->end(), num_threads);
+            check_pin_indices(net_list, num_rects, filename);
+            return net_list;
+        };
+    }
+}
+
+/**
+ * The same as read_inst_from, but with the stream operators of rectangle and net.
+ */
+void packing::read_inst_from_stream(const std::string filename)
+{
+    std::ifstream file(filename);
+    _base_filename = filename;
+
+    if (!(file >> _chip_base))
+    {
+        throw std::runtime_error("File " + filename + " has invalid format.");
+    }
+
+    _grid = grid_index();
+    _rect_list.clear();
+    _net_list.clear();
+    _net_loader = nullptr;
+
+    rectangle rect;
+    while (file >> rect)
+    {
+        if (!rect.blockage)
+        {
+            rect.id = _rect_list.size();
+            _rect_list.push_back(rect);
+        }
+    }
+    _store.assign(_rect_list);
+    _netlist_valid = false;
+
+    file.clear();
+
+    net n;
+    while (file >> n)
+    {
+        n.index = _net_list.size();
+        _net_list.push_back(n);
+    }
+    check_pin_indices(_net_list, _rect_list.size(), filename);
+}
+
+/**
+ * Copies the nets out of a mapped binary file.
+ * @param header The header of the file.
+ * @param data The beginning of the net weights in the file.
+ * @param filename The name of the file, used for error messages.
+ */
+static std::vector<net> read_binary_nets(const binary_header &header, const char *data, const std::string &filename)
+{
+    auto net_weights = reinterpret_cast<const int32_t *>(data);
+    data += header.num_nets * sizeof(int32_t);
+    auto pin_offsets = reinterpret_cast<const uint32_t *>(data);
+    data += (header.num_nets + 1) * sizeof(uint32_t);
+    auto pins = reinterpret_cast<const binary_pin *>(data);
+
+    std::vector<net> net_list(header.num_nets);
+    for (size_t i = 0; i < header.num_nets; ++i)
+    {
+        if (pin_offsets[i] > pin_offsets[i + 1] || pin_offsets[i + 1] > header.num_pins)
         {
-            line.erase(std::prev(it));
+            throw std::runtime_error("File " + filename + " has invalid format.");
         }
 
-        if (it != line.begin() && rec.intersects(_rect_list.at(*std::prev(it))))
-        {
-            return certificate(rec.id, *std::prev(it));
-        }
+        net &n = net_list[i];
+        n.index = i;
+        n.net_weight = net_weights[i];
+        n.pin_list.resize(pin_offsets[i + 1] - pin_offsets[i]);
 
-        it++;
-        // Since this does not intersect our rectangle we can go on to the rectangles above
-        while (it != line.end() && !_rect_list.at(*it).contains_x(rec.base.x))
+        for (size_t j = pin_offsets[i]; j < pin_offsets[i + 1]; ++j)
         {
-            // This looks pretty different than the other direction, due to
-            // a) line.end() points behind the end of line
-            // b) line.erase returns an iterator pointing on the element behind the deleted one
-            it = line.erase(it);
-        }
+            const binary_pin &bin_pin = pins[j];
+            if (bin_pin.index >= (int32_t) header.num_rects)
+            {
+                throw std::runtime_error("File " + filename + " has invalid format.");
+            }
 
-        if (it != line.end() && _rect_list.at(*it).intersects(rec))
-        {
-            return certificate(rec.id, *it);
+            pin &p = n.pin_list[j - pin_offsets[i]];
+            p.index = bin_pin.index;
+            p.position = point(bin_pin.x, bin_pin.y, true);
         }
-        // So this rectangle does not intersect with one already there, therefore, we can go on
     }
 
-    return certificate();
+    return net_list;
 }
 
-std::ostream &operator<<(std::ostream &out, const packing &pack)
+void packing::read_binary(const std::shared_ptr<const mapped_file> &file, const std::string &filename,
+                          binary_kind kind)
 {
-    for (auto &rect : pack._rect_list)
+    binary_header header;
+    if (file->size() < sizeof(header))
     {
-        assert(pack._chip_base.get_pos(dimension::x) <= rect.get_pos(dimension::x));
-        assert(pack._chip_base.get_max(dimension::x) >= rect.get_max(dimension::x));
-        assert(pack._chip_base.get_pos(dimension::y) <= rect.get_max(dimension::y));
-        assert(pack._chip_base.get_max(dimension::y) >= rect.get_max(dimension::y));
+        throw std::runtime_error("File " + filename + " has invalid format.");
+    }
+    std::memcpy(&header, file->begin(), sizeof(header));
 
-        out << rect << std::endl;
+    if (header.version != BINARY_VERSION)
+    {
+        throw std::runtime_error("File " + filename + " has unsupported binary version "
+                                 + std::to_string(header.version) + ".");
     }
-    return out;
-}
 
-/**
- * Reads solution, i.e. a list of placed rectangles.
- */
-void packing::read_sol_from(const std::string filename)
-{
-    std::ifstream file(filename);
+    if (header.kind != kind || file->size() != binary_file_size(header))
+    {
+        throw std::runtime_error("File " + filename + " has invalid format.");
+    }
 
-    if (!file)
+    auto rects = reinterpret_cast<const binary_rect *>(file->begin() + sizeof(header));
+    const char *net_data = file->begin() + sizeof(header) + header.num_rects * sizeof(binary_rect);
+
+    if (kind == binary_kind::instance)
     {
-        throw std::runtime_error("File not " + filename + " not found.");
+        _chip_base = rectangle(point(header.chip_base[0], header.chip_base[2], true),
+                               point(header.chip_base[1], header.chip_base[3], true));
+        _chip_base.id = -1;
     }
 
-    _rect_list.clear();
+    _grid = grid_index();
+    _rect_list.resize(header.num_rects);
+    for (size_t i = 0; i < header.num_rects; ++i)
+    {
+        rectangle &rect = _rect_list[i];
+        rect = rectangle();
+        rect.id = (int) i;
+        rect.base = point(rects[i].base_x, rects[i].base_y, rects[i].placed != 0);
+        rect.size = point(rects[i].width, rects[i].height, true);
+        rect.flipped = rects[i].flipped != 0;
+        rect.rot = static_cast<rotation>(rects[i].rot);
+
+        if (rect.size.x < 0 || rect.size.y < 0 || rects[i].rot >= (uint8_t) rotation::count)
+        {
+            throw std::runtime_error("Invalid rectangle size.");
+        }
+    }
+    _store.assign(_rect_list);
+    _netlist_valid = false;
 
-    rectangle rect;
-    while (file >> rect)
+    if (kind == binary_kind::instance)
     {
-        rect.id = _rect_list.size();
-        _rect_list.push_back(rect);
+        _net_list.clear();
+        _net_loader = nullptr;
+
+        if (header.num_nets > 0)
+        {
+            _net_loader = [file, header, net_data, filename]()
+            {
+                return read_binary_nets(header, net_data, filename);
+            };
+        }
     }
 }
 
-/**
- *  Reads just the dimension from the instance file.
- */
-void packing::read_dimension_from_inst(const std::string filename)
+void packing::write_binary(const std::string filename, binary_kind kind) const
 {
-    _base_filename = filename;
-    std::ifstream file(filename);
+    load_nets();
+
+    binary_header header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.kind = kind;
+    header.chip_base[0] = kind == binary_kind::instance ? _chip_base.get_pos(dimension::x) : 0;
+    header.chip_base[1] = kind == binary_kind::instance ? _chip_base.get_max(dimension::x) : 0;
+    header.chip_base[2] = kind == binary_kind::instance ? _chip_base.get_pos(dimension::y) : 0;
+    header.chip_base[3] = kind == binary_kind::instance ? _chip_base.get_max(dimension::y) : 0;
+    header.num_rects = (uint32_t) _rect_list.size();
+    header.num_nets = kind == binary_kind::instance ? (uint32_t) _net_list.size() : 0;
+    header.num_pins = 0;
+    header.reserved = 0;
+
+    std::vector<binary_rect> rects(_rect_list.size());
+    for (size_t i = 0; i < _rect_list.size(); ++i)
+    {
+        const rectangle &rect = _rect_list[i];
+        rects[i].base_x = rect.placed() ? rect.base.x : 0;
+        rects[i].base_y = rect.placed() ? rect.base.y : 0;
+        rects[i].width = rect.size.x;
+        rects[i].height = rect.size.y;
+        rects[i].placed = rect.placed();
+        rects[i].flipped = rect.flipped;
+        rects[i].rot = (uint8_t) rect.rot;
+        rects[i].reserved = 0;
+    }
+
+    std::vector<int32_t> net_weights;
+    std::vector<uint32_t> pin_offsets(1, 0);
+    std::vector<binary_pin> pins;
+    for (size_t i = 0; i < header.num_nets; ++i)
+    {
+        net_weights.push_back(_net_list[i].net_weight);
+        for (auto &p : _net_list[i].pin_list)
+        {
+            pins.push_back({p.index, p.position.x, p.position.y});
+        }
+        pin_offsets.push_back((uint32_t) pins.size());
+    }
+    header.num_pins = (uint32_t) pins.size();
 
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
     if (!file)
     {
-        throw std::runtime_error("File not " + filename + " not found.");
+        throw std::runtime_error("Could not open " + filename + " for writing.");
     }
 
-    file >> _chip_base;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(rects.data()), rects.size() * sizeof(binary_rect));
+    file.write(reinterpret_cast<const char *>(net_weights.data()), net_weights.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char *>(pin_offsets.data()), pin_offsets.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(pins.data()), pins.size() * sizeof(binary_pin));
 }
 
-/**
- * Read an instance, i.e. size of the chip, a list of unplaced rectangles and blockages,
- * and a list of nets.
- */
-void packing::read_inst_from(const std::string filename)
+void packing::write_inst(std::ostream &out) const
 {
-    std::ifstream file(filename);
-    _base_filename = filename;
+    load_nets();
 
-    if (!(file >> _chip_base))
+    for (dimension dim : all_dimensions)
     {
-        throw std::runtime_error("File " + filename + " has invalid format.");
+        out << _chip_base.get_pos(dim) << " " << _chip_base.get_max(dim) << (dim == dimension::y ? "\n" : " ");
     }
 
-    rectangle rect;
-    while (file >> rect)
+    for (auto &rect : _rect_list)
     {
-        if (!rect.blockage)
+        out << rect.size << "\n";
+    }
+
+    for (auto &n : _net_list)
+    {
+        out << "Net " << n.net_weight << "\n";
+        for (auto &p : n.pin_list)
         {
-            rect.id = _rect_list.size();
-            _rect_list.push_back(rect);
+            out << p << "\n";
         }
     }
+}
 
-    file.clear();
+void packing::load_nets() const
+{
+    if (_net_loader)
+    {
+        _net_list = _net_loader();
+        _net_loader = nullptr;
+    }
 
-    net n;
-    while (file >> n)
+    if (!_netlist_valid)
     {
-        n.index = _net_list.size();
-        _net_list.push_back(n);
+        build_netlist();
     }
 }
 
+void packing::build_netlist() const
+{
+    _netlist.build(_net_list, _rect_list, _chip_base);
+    _netlist_valid = true;
+}
+
+point packing::get_relative_pin_position(size_t net_index, size_t pin_index) const
+{
+    load_nets();
+    const pin &p = _net_list[net_index].pin_list[pin_index];
+    return _netlist.relative_position(_netlist.net_begin(net_index) + pin_index, pin_orientation(p.index));
+}
+
 void packing::draw_all_rectangles()
 {
     assert(_bmp.initialized);
@@ -243,12 +1095,16 @@ void packing::draw_all_rectangles()
 void packing::draw_all_pins()
 {
     assert(_bmp.initialized);
+    load_nets();
 
-    for (auto n : _net_list)
+    for (size_t i = 0; i < _net_list.size(); ++i)
     {
-        for (auto p : n.pin_list)
+        for (size_t j = 0; j < _net_list[i].pin_list.size(); ++j)
         {
-            point pin_point = get_rect(p.index).get_absolute_pin_position(p);
+            const rectangle &rect = get_rect(_net_list[i].pin_list[j].index);
+            point pin_point = get_relative_pin_position(i, j);
+            pin_point.x += rect.base.x;
+            pin_point.y += rect.base.y;
             _bmp.draw_point(pin_point, BLUE);
         }
     }
@@ -264,6 +1120,14 @@ void packing::draw_cert(const certificate &cert)
     }
 }
 
+void packing::draw_cert(const std::vector<certificate> &certs)
+{
+    for (auto &cert : certs)
+    {
+        draw_cert(cert);
+    }
+}
+
 void packing::write_bmp()
 {
     assert(_bmp.initialized);
@@ -304,9 +1168,21 @@ size_t packing::get_num_rects() const
 
 size_t packing::get_num_nets() const
 {
+    load_nets();
     return _net_list.size();
 }
 
+void packing::rect_changed(int index)
+{
+    const rectangle &rect = _rect_list[(size_t) index];
+    _store.update((size_t) index, rect);
+
+    if (_grid.active() && rect.placed())
+    {
+        _grid.update((uint32_t) index, bounds(rect));
+    }
+}
+
 void packing::move_rect(int index, point pos)
 {
     if (index < 0)
@@ -315,53 +1191,289 @@ void packing::move_rect(int index, point pos)
     }
     else
     {
-        rectangle &rect = get_rect(index);
+        rectangle &rect = _rect_list.at((size_t) index);
         rect.base = pos;
         rect.base.set = true;
+
+        // This is called for every rectangle on every evaluation, so only the position is copied
+        _store.x[(size_t) index] = pos.x;
+        _store.y[(size_t) index] = pos.y;
+
+        if (_grid.active())
+        {
+            _grid.update((uint32_t) index, bounds(rect));
+        }
     }
 }
 
-const net &packing::get_net(size_t index) const
+void packing::move_rect(int index, dimension dim, pos coordinate)
 {
-    return _net_list.at(index);
+    if (index < 0)
+    {
+        throw std::out_of_range("index");
+    }
+
+    rectangle &rect = _rect_list.at((size_t) index);
+    rect.base.coord(dim) = coordinate;
+    rect.base.set = true;
+    rect_changed(index);
 }
 
-const rectangle &packing::get_chip_base() const
+void packing::rotate_rect(int index, rotation rot)
 {
-    return _chip_base;
+    if (index < 0)
+    {
+        throw std::out_of_range("index");
+    }
+
+    _rect_list.at((size_t) index).rotate(rot);
+    rect_changed(index);
 }
 
-rectangle &packing::get_rect(int index)
+void packing::flip_rect(int index)
 {
     if (index < 0)
     {
-        return _chip_base;
+        throw std::out_of_range("index");
     }
-    else
+
+    _rect_list.at((size_t) index).flip();
+    rect_changed(index);
+}
+
+void packing::set_orientation(int index, uint8_t orientation)
+{
+    if (index < 0)
     {
-        return _rect_list.at((size_t) index);
+        throw std::out_of_range("index");
     }
+
+    const uint8_t current = _store.orientation.at((size_t) index);
+    if ((current ^ orientation) & 4)
+    {
+        _rect_list[(size_t) index].flip();
+    }
+    _rect_list[(size_t) index].rotate(static_cast<rotation>((orientation - current) & 3));
+    rect_changed(index);
 }
 
-weight packing::compute_netlength() const
+void packing::find_symmetries(bool with_pins, std::vector<size_t> &group,
+                              std::vector<std::vector<uint8_t>> &orientations) const
 {
-    weight ret = 0;
-    for (auto &n: _net_list)
+    const size_t num_rects = get_num_rects();
+
+    // The pins on every rectangle with their nets, fixed pins do not move with any rectangle
+    std::vector<std::vector<std::pair<size_t, size_t>>> pins(num_rects);
+    if (with_pins)
     {
-        bounding_box b;
-        for (auto &p: n.pin_list)
+        const csr_netlist &netlist = get_netlist();
+        for (size_t net_index = 0; net_index < netlist.num_nets(); ++net_index)
         {
-            b.add_point(get_rect(p.index).get_absolute_pin_position(p));
+            for (size_t pin = netlist.net_begin(net_index); pin < netlist.net_end(net_index); ++pin)
+            {
+                if (netlist.pin_rect(pin) < num_rects)
+                {
+                    pins[netlist.pin_rect(pin)].emplace_back(net_index, pin);
+                }
+            }
+        }
+    }
+
+    // Describes a rectangle in an orientation by its extents and its sorted pins with their nets and offsets
+    auto layout = [&](size_t index, uint8_t orientation)
+    {
+        const bool turned = ((orientation ^ _store.orientation[index]) & 1) != 0;
+        std::vector<int64_t> result{turned ? _store.height[index] : _store.width[index],
+                                    turned ? _store.width[index] : _store.height[index]};
+        std::vector<std::tuple<int64_t, int64_t, int64_t>> offsets;
+        for (const auto &pin : pins[index])
+        {
+            const point offset = get_netlist().relative_position(pin.second, orientation);
+            offsets.emplace_back((int64_t) pin.first, offset.x, offset.y);
+        }
+        std::sort(offsets.begin(), offsets.end());
+        for (const auto &offset : offsets)
+        {
+            result.push_back(std::get<0>(offset));
+            result.push_back(std::get<1>(offset));
+            result.push_back(std::get<2>(offset));
+        }
+        return result;
+    };
+
+    group.resize(num_rects);
+    orientations.assign(num_rects, std::vector<uint8_t>());
+    std::map<std::vector<int64_t>, size_t> groups;
+    const uint8_t num_candidates = with_pins ? 8 : 2;
+    for (size_t i = 0; i < num_rects; ++i)
+    {
+        const uint8_t current = _store.orientation[i];
+        std::vector<std::vector<int64_t>> layouts;
+        for (uint8_t k = 0; k < num_candidates; ++k)
+        {
+            const uint8_t orientation = (uint8_t) (((current ^ k) & 4) | ((current + k) & 3));
+            std::vector<int64_t> candidate = layout(i, orientation);
+            if (std::find(layouts.begin(), layouts.end(), candidate) == layouts.end())
+            {
+                layouts.push_back(std::move(candidate));
+                orientations[i].push_back(orientation);
+            }
+        }
+
+        // Interchangeable rectangles have the same set of layouts, so the smallest one identifies the group
+        const std::vector<int64_t> &key = *std::min_element(layouts.begin(), layouts.end());
+        group[i] = groups.emplace(key, i).first->second;
+    }
+}
+
+void packing::build_grid_index()
+{
+    bounds area;
+    area.x_min = area.x_max = area.y_min = area.y_max = 0;
+    if (_chip_base.placed())
+    {
+        area = bounds(_chip_base);
+    }
+
+    int64_t total_width = 0;
+    int64_t total_height = 0;
+    size_t num_placed = 0;
+
+    bool first = true;
+    for (auto &rect : _rect_list)
+    {
+        if (!rect.placed())
+        {
+            continue;
+        }
+
+        const bounds box(rect);
+        if (!_chip_base.placed())
+        {
+            area.x_min = first ? box.x_min : std::min(area.x_min, box.x_min);
+            area.x_max = first ? box.x_max : std::max(area.x_max, box.x_max);
+            area.y_min = first ? box.y_min : std::min(area.y_min, box.y_min);
+            area.y_max = first ? box.y_max : std::max(area.y_max, box.y_max);
+            first = false;
+        }
+        total_width += rect.get_dimension(dimension::x);
+        total_height += rect.get_dimension(dimension::y);
+        ++num_placed;
+    }
+
+    int64_t cell_width = std::max<int64_t>(total_width / std::max<size_t>(num_placed, 1), 1);
+    int64_t cell_height = std::max<int64_t>(total_height / std::max<size_t>(num_placed, 1), 1);
+
+    // Large empty areas would give lots of empty cells, we do not want more than a few cells per rectangle
+    const double max_cells = 4.0 * std::max<size_t>(num_placed, 1);
+    const double cells = std::max(((double) area.x_max - area.x_min) / cell_width, 1.0)
+                         * std::max(((double) area.y_max - area.y_min) / cell_height, 1.0);
+    if (cells > max_cells)
+    {
+        const double scale = std::sqrt(cells / max_cells);
+        cell_width = (int64_t) std::ceil(cell_width * scale);
+        cell_height = (int64_t) std::ceil(cell_height * scale);
+    }
+
+    _grid = grid_index(area, (pos) std::min<int64_t>(cell_width, std::numeric_limits<pos>::max()),
+                       (pos) std::min<int64_t>(cell_height, std::numeric_limits<pos>::max()), _rect_list.size());
+
+    for (size_t i = 0; i < _rect_list.size(); ++i)
+    {
+        if (_rect_list[i].placed())
+        {
+            _grid.update((uint32_t) i, bounds(_rect_list[i]));
+        }
+    }
+}
+
+bool packing::overlaps_any(int index) const
+{
+    const bounds box(get_rect(index));
+    if (box.empty())
+    {
+        return false;
+    }
+
+    if (_grid.active())
+    {
+        return !_grid.query(box, [index](uint32_t other)
+        {
+            return (int) other == index;
+        });
+    }
+
+    for (size_t i = 0; i < _rect_list.size(); ++i)
+    {
+        if ((int) i != index && _rect_list[i].placed() && bounds(_rect_list[i]).intersects(box))
+        {
+            return true;
         }
+    }
+    return false;
+}
+
+std::vector<int> packing::rects_in_window(const bounds &window) const
+{
+    std::vector<int> result;
 
-        ret += n.net_weight * ((weight) b.half_circumference());
+    if (_grid.active())
+    {
+        _grid.query(window, [&result](uint32_t id)
+        {
+            result.push_back((int) id);
+            return true;
+        });
+        return result;
+    }
+
+    for (size_t i = 0; i < _rect_list.size(); ++i)
+    {
+        if (_rect_list[i].placed() && bounds(_rect_list[i]).intersects(window))
+        {
+            result.push_back((int) i);
+        }
     }
+    return result;
+}
+
+const net &packing::get_net(size_t index) const
+{
+    load_nets();
+    return _net_list.at(index);
+}
+
+const rectangle &packing::get_chip_base() const
+{
+    return _chip_base;
+}
+
+const rect_store &packing::get_rect_store() const
+{
+    return _store;
+}
+
+const csr_netlist &packing::get_netlist() const
+{
+    load_nets();
+    return _netlist;
+}
 
-    return ret;
+weight packing::compute_netlength() const
+{
+    load_nets();
+    return (weight) _netlist.compute_hpwl(_store, _chip_base.base, _num_threads);
+}
+
+void packing::set_num_threads(unsigned num_threads)
+{
+    _num_threads = num_threads == 0 ? default_num_threads() : num_threads;
 }
 
 void packing::draw_all_nets()
 {
+    load_nets();
+
     for (auto const &n : _net_list)
     {
         bounding_box b;
@@ -374,11 +1486,30 @@ void packing::draw_all_nets()
 }
 
 weight packing::compute_netlength_optimal(const sequence_pair &sp)
+{
+    rect_store placement = _store;
+    const weight value = compute_netlength_optimal(sp, placement);
+    if (value == _invalid_cost)
+    {
+        return value;
+    }
+
+    for (size_t i = 0; i < _rect_list.size(); ++i)
+    {
+        move_rect((int) i, point(placement.x[i], placement.y[i], true));
+    }
+
+    assert(value == compute_netlength());
+
+    return value;
+}
+
+weight packing::compute_netlength_optimal(const sequence_pair &sp, rect_store &placement) const
 {
     weight value = 0;
     for (auto dim: all_dimensions)
     {
-        graph g = graph::make_graph(*this, dim, sp);
+        graph g = graph::make_graph(*this, placement, dim, sp);
         if (!g.compute_min_flow())
         {
             return _invalid_cost;
@@ -386,48 +1517,45 @@ weight packing::compute_netlength_optimal(const sequence_pair &sp)
         value += g.place();
     }
 
-    assert(value == compute_netlength());
+#ifndef NDEBUG
+    csr_netlist::scratch space;
+    assert(value == (weight) get_netlist().compute_hpwl(placement, _chip_base.base, space));
+#endif
 
     return value;
 }
 
-pos packing::calculate_area()
+pos packing::calculate_area() const
 {
     if (_rect_list.size() == 0)
     {
         return 0;
     }
 
-    pos area = 1;
-    for (auto dim : all_dimensions)
+    pos x_max = std::numeric_limits<pos>::min();
+    pos y_max = std::numeric_limits<pos>::min();
+    for (size_t i = 0; i < _store.x.size(); ++i)
     {
-        area *= std::max_element(_rect_list.begin(), _rect_list.end(), [dim](rectangle rect1, rectangle rect2)
-        { return rect1.get_max(dim) < rect2.get_max(dim); })->get_max(dim);
+        x_max = std::max(x_max, _store.x[i] + _store.width[i]);
+        y_max = std::max(y_max, _store.y[i] + _store.height[i]);
     }
 
-    return area;
+    return x_max * y_max;
 }
 
 pos bounding_box::half_circumference() const
 {
     assert(max.set && min.set);
-    pos sum = 0;
-    for (auto dim: all_dimensions)
-    {
-        sum += max.coord(dim) - min.coord(dim);
-    }
-    return sum;
+    return max.coord<dimension::x>() - min.coord<dimension::x>() + max.coord<dimension::y>()
+           - min.coord<dimension::y>();
 }
 
 void bounding_box::add_point(const point &p)
 {
     if (max.set)
     {
-        for (auto dim: all_dimensions)
-        {
-            max.coord(dim) = std::max(p.coord(dim), max.coord(dim));
-            min.coord(dim) = std::min(p.coord(dim), min.coord(dim));
-        }
+        add_coordinate<dimension::x>(p);
+        add_coordinate<dimension::y>(p);
     }
     else
     {
@@ -3,23 +3,37 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include <list>
 #include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <memory>
 #include <cctype>
+#include <cmath>
 #include <fstream>
 #include <sstream>
 #include <numeric>
 #include <tuple> // tie
 #include <stdexcept>
+#include <functional>
+#include <atomic>
 #include "common.h"
 #include "rectangle.h"
 #include "net.h"
 #include "bitmap.h"
 #include "sequence_pair.h"
 #include "min_cost_flow.h"
+#include "mapped_file.h"
+#include "instance_scanner.h"
+#include "binary_format.h"
+#include "parallel.h"
+#include "rank_set.h"
+#include "radix_sort.h"
+#include "interval_tree.h"
+#include "grid_index.h"
+#include "rect_store.h"
+#include "netlist.h"
 
 struct rect_ind_compare
 {
@@ -30,13 +44,25 @@ struct rect_ind_compare
 
 struct bounding_box
 {
-    point min;
-    point max;
+    point min = point(0, 0, false);
+    point max = point(0, 0, false);
 
     pos half_circumference() const;
 
     void add_point(const point &p);
 
+    /**
+     * Extends the box in one dimension, the box has to contain a point already.
+     * @tparam dim The dimension to extend.
+     * @param p The point which should be contained in the box.
+     */
+    template<dimension dim>
+    void add_coordinate(const point &p)
+    {
+        max.coord<dim>() = std::max(p.coord<dim>(), max.coord<dim>());
+        min.coord<dim>() = std::min(p.coord<dim>(), min.coord<dim>());
+    }
+
     rectangle to_rectangle() const;
 };
 
@@ -48,11 +74,69 @@ class packing
 {
 private:
     std::vector<rectangle> _rect_list;
-    std::vector<net> _net_list;
+
+    // The nets are parsed on first use by _net_loader, which is empty once they are loaded
+    mutable std::vector<net> _net_list;
+    mutable std::function<std::vector<net>()> _net_loader;
+
+    // The nets in the layout used by compute_netlength, rebuilt when the nets are loaded after reading a file
+    mutable csr_netlist _netlist;
+    mutable bool _netlist_valid = false;
+
+    // The number of threads used by compute_netlength
+    unsigned _num_threads = 1;
     bitmap _bmp;
     std::string _base_filename;
     rectangle _chip_base;
 
+    // Only active after build_grid_index(), reading a file drops it
+    grid_index _grid;
+
+    // The same data as _rect_list, every method changing a rectangle has to update it
+    rect_store _store;
+
+    /**
+     * Copies the state of a rectangle which was just changed into _store and _grid.
+     * @param index The index of the rectangle.
+     */
+    void rect_changed(int index);
+
+    /**
+     * Collects the bounds of all non-empty rectangles, empty ones do not intersect anything.
+     * @param boxes Gets the bounds.
+     * @param ids Gets the indices of the rectangles.
+     */
+    void non_empty_boxes(std::vector<bounds> &boxes, std::vector<int> &ids) const;
+
+    /**
+     * Reads a file in the binary format. The rectangles and pins are copied directly out of the mapped file.
+     * @param file The mapped file, it has to start with the magic bytes.
+     * @param filename The name of the file, used for error messages.
+     * @param kind Whether we expect an instance or a solution.
+     */
+    void read_binary(const std::shared_ptr<const mapped_file> &file, const std::string &filename, binary_kind kind);
+
+    /**
+     * Parses the nets if this did not happen yet. Every method using _net_list has to call this first. This is not
+     * thread safe, so call get_num_nets() before sharing a packing between threads.
+     */
+    void load_nets() const;
+
+    /**
+     * Builds _netlist from the current nets and rectangle sizes.
+     */
+    void build_netlist() const;
+
+    /**
+     * Returns the orientation used to look up the offset of a pin on the given rectangle in _netlist.
+     * @param index The index of the rectangle, -1 for the chip base.
+     * @return The orientation from _store, 0 for the chip base.
+     */
+    uint8_t pin_orientation(int index) const
+    {
+        return index < 0 ? 0 : _store.orientation[(size_t) index];
+    }
+
 public:
 
     /**
@@ -67,7 +151,18 @@ public:
      * @return The rectangle with this index, -1 means the chip base, so this works well with pins.
      */
     const rectangle &get_rect(int index) const;
-    rectangle &get_rect(int index);
+
+    /**
+     * Returns the rectangles as structure of arrays.
+     * @return _store
+     */
+    const rect_store &get_rect_store() const;
+
+    /**
+     * Returns the nets in compressed sparse row format, loads the nets if necessary.
+     * @return _netlist
+     */
+    const csr_netlist &get_netlist() const;
 
     /**
      * Returns the net with the given index.
@@ -76,6 +171,15 @@ public:
      */
     const net &get_net(size_t index) const;
 
+    /**
+     * Looks up the position of a pin relative to the base point of its rectangle in the current orientation of the
+     * rectangle. This is a table lookup instead of the computation in rectangle::get_relative_pin_position.
+     * @param net_index The index of the net.
+     * @param pin_index The index of the pin in the pin list of the net.
+     * @return The same as get_rect(p.index).get_relative_pin_position(p) for this pin p.
+     */
+    point get_relative_pin_position(size_t net_index, size_t pin_index) const;
+
     /**
      * Returns the number of rectangles of this instance.
      * @return _rect_list.size()
@@ -88,27 +192,132 @@ public:
      */
     size_t get_num_nets() const;
 
+    /**
+     * Moves a rectangle, the grid index is kept up to date.
+     * @param index The index of the rectangle.
+     * @param pos The new base point.
+     */
     void move_rect(int index, point pos);
 
+    /**
+     * Moves a rectangle in one dimension only and marks it as placed.
+     * @param index The index of the rectangle.
+     * @param dim The dimension to change.
+     * @param coordinate The new coordinate of the base point in this dimension.
+     */
+    void move_rect(int index, dimension dim, pos coordinate);
+
+    /**
+     * Rotates a rectangle by the given rotation, the grid index is kept up to date.
+     * @param index The index of the rectangle.
+     * @param rot The rotation to add to the current one.
+     */
+    void rotate_rect(int index, rotation rot);
+
+    /**
+     * Flips a rectangle, see rectangle::flip.
+     * @param index The index of the rectangle.
+     */
+    void flip_rect(int index);
+
+    /**
+     * Rotates and flips a rectangle into an orientation.
+     * @param index The index of the rectangle.
+     * @param orientation The orientation as in rect_store, rotation + 4 if flipped.
+     */
+    void set_orientation(int index, uint8_t orientation);
+
+    /**
+     * Finds the symmetries which a search over sequence pairs and orientations does not have to enumerate. Two
+     * rectangles are interchangeable if they have the same extents up to turning and, if pins matter, the same pins in
+     * the same nets in some orientation: exchanging them in a placement changes neither the area nor the netlength.
+     * Orientations of one rectangle are the same if they have the same extents and, if pins matter, the same pin
+     * offsets, e.g. all orientations of a square without pins.
+     * @param with_pins False if only the extents matter. Then only the current orientation and the one turned by 90
+     * degrees are considered, like rectangle_iterator does for the bounding rectangle.
+     * @param group Gets for every rectangle the smallest index of the rectangles interchangeable with it.
+     * @param orientations Gets for every rectangle its different orientations as in rect_store, the current one first.
+     */
+    void find_symmetries(bool with_pins, std::vector<size_t> &group,
+                         std::vector<std::vector<uint8_t>> &orientations) const;
+
+    /**
+     * Builds a uniform grid over the chip base (or the placed rectangles, if there is no chip base) with cells of
+     * about the average rectangle size. Afterwards overlaps_any and rects_in_window only look at nearby rectangles.
+     */
+    void build_grid_index();
+
+    /**
+     * Checks whether a rectangle intersects any other rectangle. Takes time proportional to the local density with
+     * the grid index and linear time without it.
+     * @param index The index of the rectangle.
+     * @return True if there is another rectangle with a common inner point.
+     */
+    bool overlaps_any(int index) const;
+
+    /**
+     * Finds all rectangles intersecting a window, uses the grid index if it was built.
+     * @param window The window to search.
+     * @return The indices of the rectangles with an inner point in the window.
+     */
+    std::vector<int> rects_in_window(const bounds &window) const;
+
     /**
      * Checks if this packing is valid, i.e. that no two different rectangles intersect.
+     * @param num_threads The number of threads to use. With several threads, the certificate may contain a different
+     * pair of intersecting rectangles than with one, but the validity is the same.
      * @return A certificate, if the packing is valid, the valid member of the certificate is true. Otherwise it is
      * false and the certificate contains two rectangles which intersect.
      */
-    const certificate is_valid() const;
+    const certificate is_valid(unsigned num_threads = 1) const;
+
+    /**
+     * Checks the validity like is_valid with a std::set as sweepline. This is a lot slower, but it is kept as a
+     * reference.
+     * @return A certificate like the one of is_valid, possibly with a different pair of intersecting rectangles.
+     */
+    const certificate is_valid_reference() const;
+
+    /**
+     * Finds all pairs of intersecting rectangles in O(n log n + k), where k is the number of pairs. Every pair is
+     * reported exactly once, as soon as it is found.
+     * @param report Called with a certificate for every intersecting pair.
+     */
+    void report_overlaps(const std::function<void(const certificate &)> &report) const;
+
+    /**
+     * Collects all pairs of intersecting rectangles, see report_overlaps.
+     * @return A certificate for every intersecting pair, empty if the packing is valid.
+     */
+    std::vector<certificate> all_overlaps() const;
 
     /**
-     * Computes the total netlength of this packing.
+     * Computes the total netlength of this packing with csr_netlist::compute_hpwl, on as many threads as were set by
+     * set_num_threads. The result does not depend on the number of threads.
      * @return The weighted sum of the half bounding box of all nets.
      */
     weight compute_netlength() const;
 
     /**
-     * Calculates a sequence pair which fits to the current packing.
+     * Sets the number of threads used by compute_netlength.
+     * @param num_threads The number of threads, 0 chooses the number of hardware threads.
+     */
+    void set_num_threads(unsigned num_threads);
+
+    /**
+     * Calculates a sequence pair which fits to the current packing. The sweepline is a rank_set over the ranks of
+     * the rectangles in y direction and the loci are built in linear time at the end, so this takes O(n log n).
      * @return Such a sequence pair.
      */
     sequence_pair to_sequence_pair() const;
 
+    /**
+     * Computes the same sequence pair as to_sequence_pair with a std::set as sweepline and std::list as loci. This is
+     * a lot slower, but it is kept as a reference.
+     * @return Such a sequence pair.
+     */
+    sequence_pair to_sequence_pair_reference() const;
+
     /**
      * Reads a solution file and stores it in this packing.
      * @param filename The name of the solution file to read.
@@ -116,10 +325,33 @@ public:
     void read_sol_from(const std::string filename);
 
     /**
-     * Reads an instance file and stores the instance in this packing.
+     * Reads an instance file and stores the instance in this packing. Text files are parsed in parallel. The nets are
+     * only parsed when they are needed for the first time.
      * @param filename The name of the file to read.
+     * @param num_threads The number of threads used for parsing, 0 chooses it depending on the file size.
      */
-    void read_inst_from(const std::string filename);
+    void read_inst_from(const std::string filename, unsigned num_threads = 0);
+
+    /**
+     * Reads an instance file with the stream operators of rectangle and net. This is a lot slower than
+     * read_inst_from, but it is kept as a reference.
+     * @param filename The name of the file to read.
+     */
+    void read_inst_from_stream(const std::string filename);
+
+    /**
+     * Writes this packing in the binary format. Instances contain the chip base, the sizes of the rectangles and the
+     * nets, solutions contain the placed rectangles only.
+     * @param filename The name of the file to write.
+     * @param kind Whether an instance or a solution is written.
+     */
+    void write_binary(const std::string filename, binary_kind kind) const;
+
+    /**
+     * Writes this packing as an instance in the text format. Blockages are not part of a packing and are lost.
+     * @param out The stream to write to.
+     */
+    void write_inst(std::ostream &out) const;
 
     /**
      * Reads just the dimensions of the chip base from an instance file.
@@ -147,6 +379,12 @@ public:
      */
     void draw_cert(const certificate &cert);
 
+    /**
+     * Draws several certificates into the same bitmap, e.g. the result of all_overlaps.
+     * @param certs The certificates to draw.
+     */
+    void draw_cert(const std::vector<certificate> &certs);
+
     /**
      * Draws all pins of the packing to _bmp.
      */
@@ -176,11 +414,21 @@ public:
      */
     weight compute_netlength_optimal(const sequence_pair &sp);
 
+    /**
+     * Computes a netlength optimal placement respecting this sequence pair without changing this packing, so several
+     * threads can share it. Call get_num_nets() before sharing it, see load_nets.
+     * @param sp The sequence pair which gives the left-right and above-below restrictions.
+     * @param placement The orientations and sizes of the rectangles are read from it and the optimal coordinates are
+     * written into it.
+     * @return The weight of the placement, or _invalid_cost if the rectangles do not fit into the chip base.
+     */
+    weight compute_netlength_optimal(const sequence_pair &sp, rect_store &placement) const;
+
     /**
      * Returns the area which is covered by all rectangles.
      * @return The area covered.
      */
-    pos calculate_area();
+    pos calculate_area() const;
 
     friend std::ostream &operator<<(std::ostream &out, const packing &rect);
 };
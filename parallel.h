@@ -0,0 +1,131 @@
+/*
+ * Tiny helpers to run tasks on several threads.
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Returns the number of threads to use if the user did not specify one.
+ * @return The number of hardware threads, at least 1.
+ */
+inline unsigned default_num_threads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Calls task(0), ..., task(num_tasks - 1), each on its own thread. The last task runs on the calling thread. If tasks
+ * throw, all threads are joined and then the exception of the task with the smallest index is rethrown.
+ * @param num_tasks The number of tasks to run.
+ * @param task The function to call with the task index.
+ */
+inline void run_in_parallel(size_t num_tasks, const std::function<void(size_t)> &task)
+{
+    if (num_tasks == 0)
+    {
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(num_tasks);
+    auto guarded_task = [&](size_t index)
+    {
+        try
+        {
+            task(index);
+        }
+        catch (...)
+        {
+            errors[index] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_tasks - 1);
+    for (size_t i = 0; i + 1 < num_tasks; ++i)
+    {
+        threads.emplace_back(guarded_task, i);
+    }
+
+    guarded_task(num_tasks - 1);
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto &error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * Lets a fixed number of threads wait for each other, as often as they like. The last thread to arrive calls a function
+ * before any of them goes on, so it can do serial work between two parallel phases and all threads see its results.
+ */
+class barrier
+{
+private:
+    std::mutex _mutex;
+    std::condition_variable _released;
+    const size_t _num_threads;
+    size_t _num_arrived = 0;
+    uint64_t _generation = 0;
+    std::function<void()> _completion;
+
+public:
+    /**
+     * @param num_threads The number of threads which have to arrive, at least 1.
+     * @param completion The function the last thread calls.
+     */
+    barrier(size_t num_threads, const std::function<void()> &completion) :
+            _num_threads(num_threads),
+            _completion(completion)
+    {}
+
+    /**
+     * Blocks until all threads arrived and the last one called the completion. If the completion throws, the threads
+     * are released anyway and the last one rethrows.
+     */
+    void arrive_and_wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        const uint64_t generation = _generation;
+        if (++_num_arrived < _num_threads)
+        {
+            _released.wait(lock, [&]() { return _generation != generation; });
+            return;
+        }
+
+        std::exception_ptr error;
+        try
+        {
+            _completion();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        _num_arrived = 0;
+        ++_generation;
+        _released.notify_all();
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif // PARALLEL_H
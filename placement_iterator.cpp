@@ -3,32 +3,22 @@
 rectangle_iterator &rectangle_iterator::operator++()
 {
 	_at_end = true;
-	for (auto rect_ref : _rect_list)
+	for (size_t i = 0; i < _rect_list.size(); i++)
 	{
-		auto &rect = rect_ref.get();
-		rect.rotate(rotation::rotated_90);
-
-		if (_bounds_only && rect.rot == rotation::rotated_180)
+		const std::vector<uint8_t> &options = _orientations[i];
+		if (options.size() < 2)
 		{
-			rect.rotate(rotation::rotated_180);
+			continue;
 		}
 
-		if (rect.rot != rotation::rotated_0)
+		_choice[i] = (_choice[i] + 1) % options.size();
+		_pack->set_orientation((int)_rect_list[i], options[_choice[i]]);
+
+		if (_choice[i] != 0)
 		{
 			_at_end = false;
 			break;
 		}
-
-		if (!_bounds_only)
-		{
-			rect.flip();
-
-			if (rect.flipped)
-			{
-				_at_end = false;
-				break;
-			}
-		}
 	}
 	return *this;
 }
@@ -108,7 +98,7 @@ placement_iterator::placement_iterator(packing & pack, size_t optimality, bool b
 	_bounds_only(bounds_only),
 	_at_end(false),
 	_new_subset(false),
-	_rect_it(std::vector<std::reference_wrapper<rectangle>>(), bounds_only),
+	_rect_it(pack, std::vector<size_t>(), _orientations),
 	_sp(_pack.get_num_rects())
 {
 	if (_optimality >= _pack.get_num_rects())
@@ -116,88 +106,79 @@ placement_iterator::placement_iterator(packing & pack, size_t optimality, bool b
 		throw std::out_of_range("optimality");
 	}
 
+	_pack.find_symmetries(!_bounds_only, _group, _orientations);
+
 	if (_optimality == 0)
 	{
-		std::vector<std::reference_wrapper<rectangle>> rect_list;
-		for (size_t i = 0; i < _pack.get_num_rects(); i++)
+		std::vector<size_t> rect_list(_pack.get_num_rects());
+		std::iota(rect_list.begin(), rect_list.end(), 0);
+		_rect_subset = rect_list;
+		_rect_it = rectangle_iterator(_pack, rect_list, _orientations);
+
+		//The positive locus starts sorted by groups, so every order of the groups is visited once
+		std::stable_sort(rect_list.begin(), rect_list.end(), [this](size_t first, size_t second)
 		{
-			rect_list.push_back(_pack.get_rect((int)i));
-		}
-		_rect_it = rectangle_iterator(rect_list, _bounds_only);
+			return _group[first] < _group[second];
+		});
+		_sp.positive_locus = locus(rect_list.begin(), rect_list.end());
 	}
 	else
 	{
 		//Initialize for first subset
 		_negative_subset = std::vector<size_t>(_sp.negative_locus.begin(), _sp.negative_locus.end());
 		_positive_subset = std::vector<size_t>(_sp.positive_locus.begin(), _sp.positive_locus.end());
-		_subset_positions = std::vector<std::pair<std::list<size_t>::iterator, std::list<size_t>::iterator>>(_optimality);
-		auto _pos_it = _sp.positive_locus.begin(), _neg_it = _sp.negative_locus.begin();
+		_sort_subset_by_group();
+		_subset_positions = std::vector<std::pair<size_t, size_t>>(_optimality);
 		for (size_t i = 0; i < _optimality; i++)
 		{
-			_rect_subset.push_back(std::ref(_pack.get_rect((int)_positive_subset[i])));
-			_subset_positions[i].first = _pos_it;
-			_subset_positions[i].second = _neg_it;
-			_pos_it++;
-			_neg_it++;
+			_rect_subset.push_back(_positive_subset[i]);
+			_subset_positions[i].first = _positive_subset[i];
+			_subset_positions[i].second = i;
 		}
-		_rect_it = rectangle_iterator(_rect_subset, _bounds_only);
+		_rect_it = rectangle_iterator(_pack, _rect_subset, _orientations);
 	}
 }
 
+void placement_iterator::_sort_subset_by_group()
+{
+	std::sort(_positive_subset.begin(), _positive_subset.begin() + _optimality, [this](size_t first, size_t second)
+	{
+		return std::make_pair(_group[first], first) < std::make_pair(_group[second], second);
+	});
+}
+
 void placement_iterator::_next_subset()
 {
 	_new_subset = false;
 
-	//Generate new subset
+	//Generate new subset, _next_combination needs it sorted by indices
+	std::sort(_positive_subset.begin(), _positive_subset.begin() + _optimality);
 	_at_end = !_next_combination(_positive_subset.begin(), _positive_subset.begin() + _optimality, _positive_subset.end());
 	_negative_subset.assign(_positive_subset.begin(), _positive_subset.end());
+	_sort_subset_by_group();
 
-	//Set iterators in sequence pair for new subset
-	size_t j = 0;
-	for (auto it = _sp.positive_locus.begin(); it != _sp.positive_locus.end(); it++)
+	//Find the positions of the new subset in the sequence pair
+	for (size_t j = 0; j < _optimality; j++)
 	{
-		if (j == _optimality)
-		{
-			break;
-		}
-
-		if (*it == _positive_subset[j])
-		{
-			_subset_positions[j].first = it;
-			j++;
-		}
-	}
-
-	j = 0;
-	for (auto it = _sp.negative_locus.begin(); it != _sp.negative_locus.end(); it++)
-	{
-		if (j == _optimality)
-		{
-			break;
-		}
-
-		if (*it == _negative_subset[j])
-		{
-			_subset_positions[j].second = it;
-			j++;
-		}
+		_subset_positions[j].first = _sp.positive_locus.position(_positive_subset[j]);
+		_subset_positions[j].second = _sp.negative_locus.position(_negative_subset[j]);
 	}
 
 	//Tell rectangle iterator which rectangles to permute
 	for (size_t i = 0; i < _optimality; i++)
 	{
-		_rect_subset[i] = std::ref(_pack.get_rect((int)_positive_subset[i]));
+		_rect_subset[i] = _positive_subset[i];
 	}
-	_rect_it = rectangle_iterator(_rect_subset, _bounds_only);
+	_rect_it = rectangle_iterator(_pack, _rect_subset, _orientations);
 }
 
 placement_iterator & placement_iterator::operator++()
 {
 	if (_optimality == 0) //Optimize globally
 	{
-		if (!(++_rect_it) && !std::next_permutation(_sp.negative_locus.begin(), _sp.negative_locus.end()))
+		if (!(++_rect_it) && !_sp.negative_locus.next_permutation())
 		{
-			_at_end = !std::next_permutation(_sp.positive_locus.begin(), _sp.positive_locus.end());
+			_at_end = !_sp.positive_locus.next_permutation(_group);
 		}
 	}
 	else //Optimize k-locally
@@ -213,14 +194,24 @@ placement_iterator & placement_iterator::operator++()
 			//Permute subsets
 			if (!std::next_permutation(_negative_subset.begin(), _negative_subset.begin() + _optimality))
 			{
-				_new_subset = !std::next_permutation(_positive_subset.begin(), _positive_subset.begin() + _optimality);
+				_new_subset = !std::next_permutation(_positive_subset.begin(), _positive_subset.begin() + _optimality,
+					[this](size_t first, size_t second)
+				{
+					return _group[first] < _group[second];
+				});
+
+				//Interchangeable rectangles may be exchanged by now, they are only the same in all orientations
+				if (_new_subset)
+				{
+					_sort_subset_by_group();
+				}
 			}
 
 			//Write permutation of subsets to loci
 			for (size_t i = 0; i < _subset_positions.size(); i++)
 			{
-				(*_subset_positions[i].first) = _positive_subset[i];
-				(*_subset_positions[i].second) = _negative_subset[i];
+				_sp.positive_locus.set(_subset_positions[i].first, _positive_subset[i]);
+				_sp.negative_locus.set(_subset_positions[i].second, _negative_subset[i]);
 			}
 		}
 	}
@@ -237,3 +228,8 @@ sequence_pair & placement_iterator::operator*()
 {
 	return _sp;
 }
+
+const std::vector<size_t> & placement_iterator::get_changed_rects() const
+{
+	return _rect_subset;
+}
@@ -15,26 +15,36 @@
 class rectangle_iterator
 {
 private:
-	std::vector<std::reference_wrapper<rectangle>> _rect_list;
+	packing *_pack;
+	std::vector<size_t> _rect_list;
 	bool _at_end;
-	bool _bounds_only;
+	// The orientations every rectangle of the list takes and the current choice among them
+	std::vector<std::vector<uint8_t>> _orientations;
+	std::vector<size_t> _choice;
 public:
 	/**
 	 * Constructs a rectangle iterator.
-	 * @param rect_list A list with references to the rectangles which are to be rotated. These rectangles will be
-	 * modified.
-	 * @param bounds_only Indicates whether only the bound of the rectangle (only unrotated and rotated by 90 deg) or
-	 * all possible rotations and flips (only relevant for pins) should be considered.
+	 * @param pack The packing containing the rectangles. The rectangles are rotated through it, so it stays consistent.
+	 * @param rect_list The indices of the rectangles which are to be rotated. These rectangles will be modified.
+	 * @param orientations For every rectangle of the packing the orientations to iterate, the current one first, see
+	 * packing::find_symmetries.
 	 */
-	explicit rectangle_iterator(std::vector<std::reference_wrapper<rectangle>> rect_list_, bool bounds_only_) :
-		_rect_list(rect_list_),
+	rectangle_iterator(packing &pack_, std::vector<size_t> rect_list_,
+		const std::vector<std::vector<uint8_t>> &orientations_) :
+		_pack(&pack_),
+		_rect_list(std::move(rect_list_)),
 		_at_end(false),
-		_bounds_only(bounds_only_)
-	{}
+		_choice(_rect_list.size(), 0)
+	{
+		for (auto index : _rect_list)
+		{
+			_orientations.push_back(orientations_[index]);
+		}
+	}
 
 	/**
 	 * Rotates or flips a rectangle to generate the next possibility. When incrementing the last possibility, the rectangles
-	 * are returned to the unrotated state.
+	 * are returned to their first orientation.
 	 * @return This iterator.
 	 */
 	rectangle_iterator &operator++();
@@ -53,11 +63,16 @@ private:
 	size_t _optimality;
 	bool _bounds_only;
 	bool _at_end, _new_subset;
+	// The groups of interchangeable rectangles and the different orientations of every rectangle
+	std::vector<size_t> _group;
+	std::vector<std::vector<uint8_t>> _orientations;
 	rectangle_iterator _rect_it;
 	sequence_pair _sp;
 	std::vector<size_t> _positive_subset, _negative_subset;
-	std::vector<std::pair<std::list<size_t>::iterator, std::list<size_t>::iterator>> _subset_positions;
-	std::vector<std::reference_wrapper<rectangle>> _rect_subset;
+	// The positions of the subset in the positive and the negative locus
+	std::vector<std::pair<size_t, size_t>> _subset_positions;
+	// The rectangles which are rotated and permuted, all of them when optimizing globally
+	std::vector<size_t> _rect_subset;
 
 	/**
 	 * Creates the next combination in lexicographic order. The current subset is found from [begin, middle), 
@@ -68,11 +83,18 @@ private:
 	bool _next_combination(It begin, It middle, It end);
 	void _next_subset();
 
+	/**
+	 * Sorts the subset in the positive locus by groups and then by indices. The permutations of a subset start and
+	 * end with this order.
+	 */
+	void _sort_subset_by_group();
+
 public:
 	/**
 	 * Creates a iterator which iterates over all possible combinations of sequence pairs and rotations considering
 	 * the parameters. To iterate k-optimaly, all subsets of size k are iterated and then all permutations of this subset
-	 * within the sequence pair are iterated.
+	 * within the sequence pair are iterated. Interchangeable rectangles, see packing::find_symmetries, are never
+	 * exchanged with each other in the positive locus, and only orientations which make a difference are iterated.
 	 * @param pack The packing over which the iteration should be performed. The rectangles in this packing will be rotated
 	 * and thus modified.
 	 * @param optimality The maximum number of rectangles that will be interchanged in each step. If zero the sequence pair
@@ -99,6 +121,13 @@ public:
 	 * @return This sequence pair
 	 */
 	sequence_pair &operator*();
+
+	/**
+	 * Gets the rectangles which may have been rotated or moved in the sequence pair by the last increment, e.g. for
+	 * incremental_sp_evaluator::evaluate.
+	 * @return The current subset in k-local mode, all rectangles otherwise.
+	 */
+	const std::vector<size_t> &get_changed_rects() const;
 };
 
 #endif // !PLACEMENT_ITERATOR_H
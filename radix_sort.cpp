@@ -0,0 +1,59 @@
+#include "radix_sort.h"
+
+#include <array>
+#include <algorithm>
+
+static constexpr unsigned DIGIT_BITS = 11;
+static constexpr uint32_t DIGIT_MASK = (1u << DIGIT_BITS) - 1;
+static constexpr unsigned NUM_PASSES = (32 + DIGIT_BITS - 1) / DIGIT_BITS;
+
+std::vector<uint32_t> radix_order(const std::vector<int32_t> &keys)
+{
+    const size_t n = keys.size();
+
+    // Flipping the sign bit maps the signed order to the unsigned order
+    std::vector<uint32_t> unsigned_keys(n);
+    std::array<std::array<size_t, DIGIT_MASK + 1>, NUM_PASSES> counts{};
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned_keys[i] = (uint32_t) keys[i] ^ 0x80000000u;
+        for (unsigned pass = 0; pass < NUM_PASSES; ++pass)
+        {
+            ++counts[pass][(unsigned_keys[i] >> (pass * DIGIT_BITS)) & DIGIT_MASK];
+        }
+    }
+
+    std::vector<uint32_t> order(n), buffer(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        order[i] = (uint32_t) i;
+    }
+
+    for (unsigned pass = 0; pass < NUM_PASSES; ++pass)
+    {
+        auto &count = counts[pass];
+
+        // If all keys have the same digit, this pass would not change anything
+        if (n == 0 || count[(unsigned_keys[0] >> (pass * DIGIT_BITS)) & DIGIT_MASK] == n)
+        {
+            continue;
+        }
+
+        size_t sum = 0;
+        for (auto &c : count)
+        {
+            const size_t tmp = c;
+            c = sum;
+            sum += tmp;
+        }
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            const uint32_t index = order[i];
+            buffer[count[(unsigned_keys[index] >> (pass * DIGIT_BITS)) & DIGIT_MASK]++] = index;
+        }
+        order.swap(buffer);
+    }
+
+    return order;
+}
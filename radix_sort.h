@@ -0,0 +1,15 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Computes the order of the given keys with a stable LSD radix sort. Passes over digits which are equal for all keys
+ * are skipped, so small coordinate ranges only need one or two passes.
+ * @param keys The keys to sort.
+ * @return The indices of the keys ordered by key, equal keys are ordered by index.
+ */
+std::vector<uint32_t> radix_order(const std::vector<int32_t> &keys);
+
+#endif // RADIX_SORT_H
@@ -0,0 +1,161 @@
+#include "rank_set.h"
+
+#include <algorithm>
+
+constexpr size_t rank_set::npos;
+
+static constexpr size_t WORD_BITS = 64;
+static constexpr size_t WORD_SHIFT = 6;
+
+static inline size_t lowest_bit(uint64_t word)
+{
+    return (size_t) __builtin_ctzll(word);
+}
+
+static inline size_t highest_bit(uint64_t word)
+{
+    return WORD_BITS - 1 - (size_t) __builtin_clzll(word);
+}
+
+rank_set::rank_set(size_t size) :
+        _size(size)
+{
+    size_t words = size;
+    do
+    {
+        words = (words + WORD_BITS - 1) / WORD_BITS;
+        _levels.emplace_back(std::max<size_t>(words, 1), 0);
+    } while (words > 1);
+}
+
+size_t rank_set::size() const
+{
+    return _size;
+}
+
+void rank_set::insert(size_t element)
+{
+    for (auto &level : _levels)
+    {
+        uint64_t &word = level[element >> WORD_SHIFT];
+        const bool was_empty = word == 0;
+        word |= uint64_t(1) << (element & (WORD_BITS - 1));
+
+        if (!was_empty)
+        {
+            // The upper levels already know about this word
+            return;
+        }
+        element >>= WORD_SHIFT;
+    }
+}
+
+void rank_set::erase(size_t element)
+{
+    for (auto &level : _levels)
+    {
+        uint64_t &word = level[element >> WORD_SHIFT];
+        word &= ~(uint64_t(1) << (element & (WORD_BITS - 1)));
+
+        if (word != 0)
+        {
+            return;
+        }
+        element >>= WORD_SHIFT;
+    }
+}
+
+bool rank_set::contains(size_t element) const
+{
+    return (_levels.front()[element >> WORD_SHIFT] >> (element & (WORD_BITS - 1))) & 1;
+}
+
+void rank_set::clear()
+{
+    for (auto &level : _levels)
+    {
+        std::fill(level.begin(), level.end(), 0);
+    }
+}
+
+size_t rank_set::predecessor(size_t element) const
+{
+    if (_size == 0)
+    {
+        return npos;
+    }
+    element = std::min(element, _size - 1);
+
+    // Go up until we find a set bit left of our position
+    size_t level = 0;
+    while (true)
+    {
+        if (level == _levels.size())
+        {
+            return npos;
+        }
+
+        const size_t word_index = element >> WORD_SHIFT;
+        const uint64_t mask = ~uint64_t(0) >> (WORD_BITS - 1 - (element & (WORD_BITS - 1)));
+        const uint64_t bits = _levels[level][word_index] & mask;
+        if (bits != 0)
+        {
+            element = (word_index << WORD_SHIFT) | highest_bit(bits);
+            break;
+        }
+
+        if (word_index == 0)
+        {
+            return npos;
+        }
+        element = word_index - 1;
+        ++level;
+    }
+
+    // Go down and always take the rightmost child
+    while (level > 0)
+    {
+        --level;
+        element = (element << WORD_SHIFT) | highest_bit(_levels[level][element]);
+    }
+
+    return element;
+}
+
+size_t rank_set::successor(size_t element) const
+{
+    // Go up until we find a set bit right of our position
+    size_t level = 0;
+    while (true)
+    {
+        if (level == _levels.size())
+        {
+            return npos;
+        }
+
+        const size_t word_index = element >> WORD_SHIFT;
+        if (word_index >= _levels[level].size())
+        {
+            return npos;
+        }
+
+        const uint64_t bits = _levels[level][word_index] & (~uint64_t(0) << (element & (WORD_BITS - 1)));
+        if (bits != 0)
+        {
+            element = (word_index << WORD_SHIFT) | lowest_bit(bits);
+            break;
+        }
+
+        element = word_index + 1;
+        ++level;
+    }
+
+    // Go down and always take the leftmost child
+    while (level > 0)
+    {
+        --level;
+        element = (element << WORD_SHIFT) | lowest_bit(_levels[level][element]);
+    }
+
+    return element;
+}
@@ -0,0 +1,103 @@
+#ifndef RANK_SET_H
+#define RANK_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * A set of integers from a fixed universe [0, size). It is a tree of bitsets with 64 children per node, so insert,
+ * erase, predecessor and successor queries take O(log_64 size) and only touch a handful of words. We use this to keep
+ * elements ordered by their rank, e.g. the active rectangles of a sweepline ordered by their y coordinate.
+ */
+class rank_set
+{
+private:
+    size_t _size;
+
+    // _levels[0] has a bit for every element, a bit of _levels[i + 1] is set iff the corresponding word of _levels[i]
+    // is non-zero. The last level consists of a single word.
+    std::vector<std::vector<uint64_t>> _levels;
+
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    rank_set() :
+            rank_set(0)
+    {}
+
+    /**
+     * Creates an empty set.
+     * @param size The size of the universe, all elements have to be smaller than this.
+     */
+    explicit rank_set(size_t size);
+
+    /**
+     * Returns the size of the universe.
+     * @return _size
+     */
+    size_t size() const;
+
+    void insert(size_t element);
+
+    void erase(size_t element);
+
+    bool contains(size_t element) const;
+
+    /**
+     * Removes all elements.
+     */
+    void clear();
+
+    /**
+     * Finds the largest element which is not greater than the given one.
+     * @param element The element to search from, does not need to be contained.
+     * @return The predecessor or npos if there is none.
+     */
+    size_t predecessor(size_t element) const;
+
+    /**
+     * Finds the smallest element which is not smaller than the given one.
+     * @param element The element to search from, does not need to be contained.
+     * @return The successor or npos if there is none.
+     */
+    size_t successor(size_t element) const;
+
+    /**
+     * Calls the function for every element in increasing order. This scans the words of the two lowest levels
+     * instead of searching the tree for every element, so it is a lot faster than a loop over successor.
+     * @param function Takes the element.
+     */
+    template<class function_type>
+    void for_each(function_type function) const
+    {
+        auto for_each_bit = [](uint64_t word, size_t offset, function_type &callback)
+        {
+            for (; word != 0; word &= word - 1)
+            {
+                callback(offset | (size_t) __builtin_ctzll(word));
+            }
+        };
+
+        if (_levels.size() == 1)
+        {
+            for_each_bit(_levels[0][0], 0, function);
+            return;
+        }
+
+        // A bit of the second level marks a non-empty word of the first one
+        const std::vector<uint64_t> &words = _levels[0];
+        const std::vector<uint64_t> &used = _levels[1];
+        for (size_t i = 0; i < used.size(); ++i)
+        {
+            for (uint64_t word = used[i]; word != 0; word &= word - 1)
+            {
+                const size_t index = (i << 6) | (size_t) __builtin_ctzll(word);
+                for_each_bit(words[index], index << 6, function);
+            }
+        }
+    }
+};
+
+#endif // RANK_SET_H
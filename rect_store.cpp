@@ -0,0 +1,24 @@
+#include "rect_store.h"
+
+void rect_store::assign(const std::vector<rectangle> &rects)
+{
+    x.resize(rects.size());
+    y.resize(rects.size());
+    width.resize(rects.size());
+    height.resize(rects.size());
+    orientation.resize(rects.size());
+
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        update(i, rects[i]);
+    }
+}
+
+void rect_store::update(size_t index, const rectangle &rect)
+{
+    x[index] = rect.base.x;
+    y[index] = rect.base.y;
+    width[index] = rect.get_dimension(dimension::x);
+    height[index] = rect.get_dimension(dimension::y);
+    orientation[index] = (uint8_t) ((int) rect.rot + (rect.flipped ? 4 : 0));
+}
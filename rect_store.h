@@ -0,0 +1,56 @@
+#ifndef RECT_STORE_H
+#define RECT_STORE_H
+
+#include <cstdint>
+#include <vector>
+#include "common.h"
+#include "rectangle.h"
+
+/**
+ * The rectangles of a packing as structure of arrays, so the loops over all rectangles run over contiguous memory
+ * instead of going through the accessors of rectangle. width and height observe the rotation, orientation is the
+ * rotation plus 4 if the rectangle is flipped. packing keeps this in sync with its rectangles.
+ */
+struct rect_store
+{
+    std::vector<pos> x;
+    std::vector<pos> y;
+    std::vector<pos> width;
+    std::vector<pos> height;
+    std::vector<uint8_t> orientation;
+
+    /**
+     * Replaces the content by the given rectangles.
+     * @param rects The rectangles of the packing.
+     */
+    void assign(const std::vector<rectangle> &rects);
+
+    /**
+     * Copies the current state of one rectangle.
+     * @param index The index of the rectangle.
+     * @param rect The rectangle.
+     */
+    void update(size_t index, const rectangle &rect);
+
+    /**
+     * Returns the coordinates of the base points in the given dimension.
+     * @param dim The dimension.
+     * @return x or y
+     */
+    const std::vector<pos> &position(dimension dim) const
+    {
+        return dim == dimension::x ? x : y;
+    }
+
+    /**
+     * Returns the extents of the rectangles in the given dimension.
+     * @param dim The dimension.
+     * @return width or height
+     */
+    const std::vector<pos> &extent(dimension dim) const
+    {
+        return dim == dimension::x ? width : height;
+    }
+};
+
+#endif // RECT_STORE_H
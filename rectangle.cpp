@@ -138,11 +138,6 @@ bool rectangle::contains(const pos to_check, dimension dim) const
     return base.coord(dim) <= to_check && to_check < get_max(dim);
 }
 
-bool rectangle::rotated() const
-{
-    return rot == rotation::rotated_90 || rot == rotation::rotated_270;
-}
-
 bool rectangle::contains_x(const pos to_check) const
 {
     return contains(to_check, dimension::x);
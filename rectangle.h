@@ -5,6 +5,7 @@
 #include <cassert>
 #include <tuple> // tie
 #include <algorithm>
+#include <limits>
 #include "net.h"
 #include "common.h"
 
@@ -35,7 +36,10 @@ struct rectangle
      * Checks whether the rectangle is rotated by 90 or 270 degrees, so the width and height are interchanged
      * @return rot == rotated_90 || rot == rotated_270
      */
-    bool rotated() const;
+    bool rotated() const
+    {
+        return rot == rotation::rotated_90 || rot == rotation::rotated_270;
+    }
 
     /**
      * For the following methods, the left and lower edge of the rectangle belongs to the rectangle, but the
@@ -94,6 +98,30 @@ struct rectangle
 
     point get_max_point() const;
 
+    /**
+     * Variants of get_dimension, get_pos and get_max for a dimension known at compile time. They do not go through
+     * the switch of point::coord, which makes a difference in the inner loops.
+     */
+    template<dimension dim>
+    pos get_dimension() const
+    {
+        return rotated() ? size.coord<other_dimension(dim)>() : size.coord<dim>();
+    }
+
+    template<dimension dim>
+    pos get_pos() const
+    {
+        assert(placed());
+        return base.coord<dim>();
+    }
+
+    template<dimension dim>
+    pos get_max() const
+    {
+        assert(placed());
+        return base.coord<dim>() + get_dimension<dim>();
+    }
+
     /**
      * Checks if the rectangle is already placed.
      * @return base.set
@@ -135,6 +163,12 @@ struct rectangle
      */
     pos get_relative_pin_position(const pin &p, dimension dim) const;
 
+    template<dimension dim>
+    pos get_relative_pin_position(const pin &p) const
+    {
+        return get_relative_pin_position(p).coord<dim>();
+    }
+
     /**
      * Returns the relative position of a pin on this rectangle. Flipping and
      * rotation are observed. Only works if the pin belongs to the rectangle.
@@ -182,6 +216,46 @@ struct rectangle
     static bool compare(const rectangle &left, const rectangle &right);
 };
 
+/**
+ * The coordinates of a placed rectangle, for loops that do not want to go through the accessors of rectangle.
+ */
+struct bounds
+{
+    pos x_min;
+    pos x_max;
+    pos y_min;
+    pos y_max;
+
+    bounds() = default;
+
+    explicit bounds(const rectangle &rect) :
+            x_min(rect.get_pos(dimension::x)),
+            x_max(rect.get_max(dimension::x)),
+            y_min(rect.get_pos(dimension::y)),
+            y_max(rect.get_max(dimension::y))
+    {}
+
+    /**
+     * Checks whether these bounds have no inner point.
+     * @return True if the width or the height is zero.
+     */
+    bool empty() const
+    {
+        return x_min >= x_max || y_min >= y_max;
+    }
+
+    /**
+     * Checks whether these bounds and other have an inner point in common, like rectangle::intersects.
+     * @param other The bounds to check.
+     * @return True if they intersect.
+     */
+    bool intersects(const bounds &other) const
+    {
+        return !empty() && !other.empty()
+               && x_min < other.x_max && other.x_min < x_max && y_min < other.y_max && other.y_min < y_max;
+    }
+};
+
 std::ostream &operator<<(std::ostream &out, const rectangle &rect);
 
 std::istream &operator>>(std::istream &in, rectangle &rect);
@@ -1,5 +1,73 @@
 #include "sequence_pair.h"
 
+locus::locus(size_t length) :
+	_order(length),
+	_position(length)
+{
+	std::iota(_order.begin(), _order.end(), 0);
+	std::iota(_position.begin(), _position.end(), 0);
+}
+
+void locus::push_back(size_t rect)
+{
+	if (rect >= _position.size())
+	{
+		_position.resize(rect + 1);
+	}
+	_position[rect] = _order.size();
+	_order.push_back(rect);
+}
+
+void locus::swap(size_t first, size_t second)
+{
+	std::swap(_order[_position[first]], _order[_position[second]]);
+	std::swap(_position[first], _position[second]);
+}
+
+void locus::move(size_t rect, size_t position)
+{
+	const size_t old_position = _position[rect];
+	if (old_position < position)
+	{
+		std::rotate(_order.begin() + old_position, _order.begin() + old_position + 1, _order.begin() + position + 1);
+		update_positions(old_position, position + 1);
+	}
+	else if (position < old_position)
+	{
+		std::rotate(_order.begin() + position, _order.begin() + old_position, _order.begin() + old_position + 1);
+		update_positions(position, old_position + 1);
+	}
+}
+
+bool locus::next_permutation()
+{
+	const bool next = std::next_permutation(_order.begin(), _order.end());
+	update_positions(0, _order.size());
+	return next;
+}
+
+bool locus::next_permutation(const std::vector<size_t> &group)
+{
+	const bool next = std::next_permutation(_order.begin(), _order.end(), [&group](size_t first, size_t second)
+	{
+		return group[first] < group[second];
+	});
+	update_positions(0, _order.size());
+	return next;
+}
+
+void locus::update_positions(size_t first, size_t last)
+{
+	if (_position.size() < _order.size())
+	{
+		_position.resize(_order.size());
+	}
+	for (size_t i = first; i < last; ++i)
+	{
+		_position[_order[i]] = i;
+	}
+}
+
 std::ostream &operator<<(std::ostream &out, const sequence_pair & sp)
 {
 	out << "Positive Locus: ";
@@ -20,28 +88,24 @@ std::ostream &operator<<(std::ostream &out, const sequence_pair & sp)
 	return  out;
 }
 
-std::vector<pos> sequence_pair::place_dimension(dimension dim, const packing & pack) const
+template<dimension dim>
+std::vector<pos> sequence_pair::place_dimension_map(const packing & pack) const
 {
 	std::vector<pos> positions(pack.get_num_rects());
 
-	std::vector<size_t> y_indexes(pack.get_num_rects());
-	int i = 0;
-	for (auto b : negative_locus)
-	{
-		y_indexes[b] = i++;
-	}
+	const std::vector<pos> &extents = pack.get_rect_store().extent(dim);
 
 	std::map<size_t, pos> cur_seqs;
 	cur_seqs[0] = 0; //This is the node for no seq found
 
 	auto loop_content = [&](const size_t pack_index)
 	{
-		size_t y_index = y_indexes[pack_index];
+		size_t y_index = negative_locus.position(pack_index);
 		//We insert with length 0 to optimize the greatest index less than search
 		//0 is the node for no seq found so we treat the indices one-based in the context of cur_seqs
 		const auto cur_node = cur_seqs.insert({ y_index + 1, 0 }).first;
 		positions[pack_index] = std::prev(cur_node)->second;
-		pos cur_seq_length = positions[pack_index] + pack.get_rect((int)pack_index).get_dimension(dim);
+		pos cur_seq_length = positions[pack_index] + extents[pack_index];
 		cur_seqs[y_index + 1] = cur_seq_length;
 
 		//We go forward until we no longer need to delete nodes
@@ -64,31 +128,442 @@ std::vector<pos> sequence_pair::place_dimension(dimension dim, const packing & p
 	return positions;
 }
 
-bool sequence_pair::apply_to(packing & pack) const
+void sp_scratch::reset(size_t num_rects)
+{
+	if (candidates.size() != num_rects + 1)
+	{
+		candidates = rank_set(num_rects + 1);
+	}
+	else
+	{
+		candidates.clear();
+	}
+	lengths.resize(num_rects + 1);
+	coordinates[0].resize(num_rects);
+	coordinates[1].resize(num_rects);
+
+	lengths[0] = 0;
+	candidates.insert(0);
+}
+
+// A position k + 1 in the negative locus is a candidate if there is a chain ending at the rectangle with position k
+// and no candidate with a smaller key has a chain at least as long. So the lengths grow with the keys, and key 0
+// stands for the empty chain. The reverse pass is the same on both loci reversed, which mirrors the placement.
+template<dimension dim, bool reverse>
+bool sequence_pair::fast_pass(const std::vector<pos> &extents, pos limit, sp_scratch &scratch,
+                              std::vector<pos> &coordinates, pos &extent) const
+{
+	rank_set &candidates = scratch.candidates;
+	std::vector<pos> &lengths = scratch.lengths;
+	extent = 0;
+
+	auto loop_content = [&](const size_t pack_index)
+	{
+		const size_t key = reverse ? negative_locus.size() - negative_locus.position(pack_index)
+		                           : negative_locus.position(pack_index) + 1;
+
+		//The key is not in the set yet and 0 always is, so this is the best chain left of the rectangle
+		const pos position = lengths[candidates.predecessor(key)];
+		coordinates[pack_index] = position;
+
+		const pos length = position + extents[pack_index];
+		lengths[key] = length;
+		candidates.insert(key);
+		extent = std::max(extent, length);
+
+		//Candidates behind the new one with a shorter chain are dominated now
+		for (size_t next = candidates.successor(key + 1);
+		     next != rank_set::npos && lengths[next] < length;
+		     next = candidates.successor(next + 1))
+		{
+			candidates.erase(next);
+		}
+
+		return length <= limit;
+	};
+
+	if ((dim == dimension::x) != reverse)
+	{
+		for (auto it = positive_locus.begin(); it != positive_locus.end(); ++it)
+		{
+			if (!loop_content(*it))
+			{
+				return false;
+			}
+		}
+	}
+	else
+	{
+		for (auto it = positive_locus.rbegin(); it != positive_locus.rend(); ++it)
+		{
+			if (!loop_content(*it))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+template<dimension dim>
+std::vector<pos> sequence_pair::place_dimension_fast(const packing & pack, sp_scratch &scratch) const
+{
+	std::vector<pos> positions(pack.get_num_rects());
+	pos extent;
+	scratch.reset(pack.get_num_rects());
+	fast_pass<dim, false>(pack.get_rect_store().extent(dim), std::numeric_limits<pos>::max(), scratch, positions,
+	                      extent);
+	return positions;
+}
+
+sp_bounds sequence_pair::evaluate(const std::vector<pos> &widths, const std::vector<pos> &heights,
+                                  const rectangle &chip_base, sp_scratch &scratch) const
+{
+	sp_bounds bounds;
+	bounds.fits = false;
+
+	scratch.reset(widths.size());
+	if (!fast_pass<dimension::x, false>(widths, chip_base.get_dimension(dimension::x), scratch,
+	                                    scratch.coordinates[0], bounds.width))
+	{
+		return bounds;
+	}
+
+	scratch.reset(widths.size());
+	if (!fast_pass<dimension::y, false>(heights, chip_base.get_dimension(dimension::y), scratch,
+	                                    scratch.coordinates[1], bounds.height))
+	{
+		return bounds;
+	}
+
+	bounds.fits = true;
+	if (widths.empty())
+	{
+		bounds.area = 0;
+	}
+	else
+	{
+		//calculate_area measures from the origin, not from the chip base. Against a loose chip base the product may
+		//exceed pos, it saturates then.
+		const int64_t area = (int64_t)(chip_base.get_pos(dimension::x) + bounds.width)
+		                     * (chip_base.get_pos(dimension::y) + bounds.height);
+		bounds.area = (pos)std::min<int64_t>(area, std::numeric_limits<pos>::max());
+	}
+	return bounds;
+}
+
+void sequence_pair::evaluate_tails(const std::vector<pos> &widths, const std::vector<pos> &heights,
+                                   sp_scratch &scratch) const
+{
+	pos extent;
+	scratch.tails[0].resize(widths.size());
+	scratch.tails[1].resize(widths.size());
+
+	scratch.reset(widths.size());
+	fast_pass<dimension::x, true>(widths, std::numeric_limits<pos>::max(), scratch, scratch.tails[0], extent);
+
+	scratch.reset(widths.size());
+	fast_pass<dimension::y, true>(heights, std::numeric_limits<pos>::max(), scratch, scratch.tails[1], extent);
+}
+
+sp_bounds sequence_pair::evaluate(const packing & pack, sp_scratch & scratch) const
 {
 	if (pack.get_num_rects() != positive_locus.size())
 	{
 		throw std::invalid_argument("Sequence pair length does not match packing");
 	}
 
-	auto x_coords = place_dimension(dimension::x, pack);
-	auto y_coords = place_dimension(dimension::y, pack);
+	const rect_store &store = pack.get_rect_store();
+	return evaluate(store.width, store.height, pack.get_chip_base(), scratch);
+}
+
+void sequence_pair::place_evaluated(packing & pack, const sp_scratch & scratch)
+{
+	place_rects(pack, scratch.coordinates[0], scratch.coordinates[1]);
+}
+
+std::vector<pos> sequence_pair::place_dimension(dimension dim, const packing & pack, sp_evaluator evaluator) const
+{
+	if (evaluator == sp_evaluator::map)
+	{
+		return dim == dimension::x ? place_dimension_map<dimension::x>(pack) : place_dimension_map<dimension::y>(pack);
+	}
+	sp_scratch scratch;
+	return place_dimension(dim, pack, scratch);
+}
+
+std::vector<pos> sequence_pair::place_dimension(dimension dim, const packing & pack, sp_scratch &scratch) const
+{
+	return dim == dimension::x ? place_dimension_fast<dimension::x>(pack, scratch)
+	                           : place_dimension_fast<dimension::y>(pack, scratch);
+}
 
+bool sequence_pair::place_rects(packing &pack, const std::vector<pos> &x_coords, const std::vector<pos> &y_coords)
+{
 	//We are placing rectangles starting (0,0), but the placmenet area might be different
 	auto x_offset = pack.get_chip_base().get_pos(dimension::x);
 	auto y_offset = pack.get_chip_base().get_pos(dimension::y);
 
+	const pos x_bound = pack.get_chip_base().get_max(dimension::x);
+	const pos y_bound = pack.get_chip_base().get_max(dimension::y);
+	const rect_store &store = pack.get_rect_store();
+
 	for (size_t i = 0; i < x_coords.size(); i++)
 	{
 		pack.move_rect((int)i, point(x_coords[i] + x_offset, y_coords[i] + y_offset, true));
 
 		//Check if rectangle is placed within bounds
-		if (pack.get_rect((int)i).get_max(dimension::x) > pack.get_chip_base().get_max(dimension::x)
-			|| pack.get_rect((int)i).get_max(dimension::y) > pack.get_chip_base().get_max(dimension::y))
+		if (store.x[i] + store.width[i] > x_bound || store.y[i] + store.height[i] > y_bound)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool sequence_pair::apply_to(packing & pack, sp_evaluator evaluator) const
+{
+	if (pack.get_num_rects() != positive_locus.size())
+	{
+		throw std::invalid_argument("Sequence pair length does not match packing");
+	}
+
+	if (evaluator == sp_evaluator::map)
+	{
+		return place_rects(pack, place_dimension(dimension::x, pack, evaluator),
+		                   place_dimension(dimension::y, pack, evaluator));
+	}
+
+	sp_scratch scratch;
+	return place_rects(pack, place_dimension(dimension::x, pack, scratch),
+	                   place_dimension(dimension::y, pack, scratch));
+}
+
+
+bool sequence_pair::apply_to(packing & pack, incremental_sp_evaluator & evaluator) const
+{
+	if (pack.get_num_rects() != positive_locus.size())
+	{
+		throw std::invalid_argument("Sequence pair length does not match packing");
+	}
+
+	if (!evaluator.evaluate(*this, pack).fits)
+	{
+		return false;
+	}
+	return place_rects(pack, evaluator.get_coordinates(dimension::x), evaluator.get_coordinates(dimension::y));
+}
+
+bool incremental_sp_evaluator::reset(const sequence_pair & sp, const rect_store & store)
+{
+	const size_t n = sp.positive_locus.size();
+	if (_positive_position.size() == n && _states[0].coordinates.size() == n)
+	{
+		return false;
+	}
+
+	_positive_position.resize(n);
+	_negative_position.resize(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		_positive_position[i] = sp.positive_locus.position(i);
+		_negative_position[i] = sp.negative_locus.position(i);
+	}
+	_extents[0] = store.width;
+	_extents[1] = store.height;
+
+	_candidates = rank_set(n + 1);
+	_lengths.resize(n + 1);
+	_interval = std::max<size_t>(32, (size_t)std::sqrt((double)n));
+	_snapshot_budget = 4 * n + 64;
+
+	for (auto &state : _states)
+	{
+		state.coordinates.resize(n);
+		state.valid = 0;
+	}
+	return true;
+}
+
+void incremental_sp_evaluator::compare(const sequence_pair & sp, const rect_store & store, size_t rect)
+{
+	const size_t positive = sp.positive_locus.position(rect);
+	const size_t negative = sp.negative_locus.position(rect);
+	const bool moved = _positive_position[rect] != positive || _negative_position[rect] != negative;
+	const bool wider = _extents[0][rect] != store.width[rect];
+	const bool higher = _extents[1][rect] != store.height[rect];
+	if (!moved && !wider && !higher)
+	{
+		return;
+	}
+
+	_positive_position[rect] = positive;
+	_negative_position[rect] = negative;
+	_extents[0][rect] = store.width[rect];
+	_extents[1][rect] = store.height[rect];
+
+	//A rectangle which moved away from a position is replaced by one which moved there, so the new positions are
+	//enough. A dimension which was not evaluated last time keeps its older changes.
+	if (moved || wider)
+	{
+		_states[0].valid = std::min(_states[0].valid, positive);
+	}
+	if (moved || higher)
+	{
+		_states[1].valid = std::min(_states[1].valid, _positive_position.size() - 1 - positive);
+	}
+}
+
+sp_bounds incremental_sp_evaluator::evaluate(const sequence_pair & sp, const packing & pack)
+{
+	const rect_store &store = pack.get_rect_store();
+	if (!reset(sp, store))
+	{
+		for (size_t rect = 0; rect < _positive_position.size(); rect++)
+		{
+			compare(sp, store, rect);
+		}
+	}
+	return evaluate_invalid(sp, pack);
+}
+
+sp_bounds incremental_sp_evaluator::evaluate(const sequence_pair & sp, const packing & pack,
+                                             const std::vector<size_t> & changed)
+{
+	const rect_store &store = pack.get_rect_store();
+	if (!reset(sp, store))
+	{
+		for (auto rect : changed)
 		{
+			compare(sp, store, rect);
+		}
+	}
+	return evaluate_invalid(sp, pack);
+}
+
+sp_bounds incremental_sp_evaluator::evaluate_invalid(const sequence_pair & sp, const packing & pack)
+{
+	sp_bounds bounds;
+	bounds.fits = false;
+
+	const rectangle &chip_base = pack.get_chip_base();
+	const rect_store &store = pack.get_rect_store();
+	if (!evaluate_from_valid<dimension::x>(sp, store.width, chip_base.get_dimension(dimension::x))
+	    || !evaluate_from_valid<dimension::y>(sp, store.height, chip_base.get_dimension(dimension::y)))
+	{
+		return bounds;
+	}
+
+	bounds.fits = true;
+	bounds.width = _states[0].extent;
+	bounds.height = _states[1].extent;
+	if (_positive_position.empty())
+	{
+		bounds.area = 0;
+	}
+	else
+	{
+		//The same as in sequence_pair::evaluate
+		const int64_t area = (int64_t)(chip_base.get_pos(dimension::x) + bounds.width)
+		                     * (chip_base.get_pos(dimension::y) + bounds.height);
+		bounds.area = (pos)std::min<int64_t>(area, std::numeric_limits<pos>::max());
+	}
+	return bounds;
+}
+
+template<dimension dim>
+bool incremental_sp_evaluator::evaluate_from_valid(const sequence_pair & sp, const std::vector<pos> & extents,
+                                                   pos limit)
+{
+	const size_t n = _positive_position.size();
+	dimension_state &state = _states[(int)dim];
+	if (state.valid == n)
+	{
+		return state.extent <= limit;
+	}
+
+	// Go back to the last snapshot before the first step which is not valid and drop the later ones
+	size_t snapshot = std::upper_bound(state.snapshot_step.begin(), state.snapshot_step.end(), state.valid)
+	                  - state.snapshot_step.begin();
+	_candidates.clear();
+	size_t step = 0;
+	if (snapshot == 0)
+	{
+		state.snapshot_step.clear();
+		state.snapshot_begin.assign(1, 0);
+		state.snapshot_keys.clear();
+		state.snapshot_lengths.clear();
+
+		_lengths[0] = 0;
+		_candidates.insert(0);
+	}
+	else
+	{
+		snapshot--;
+		step = state.snapshot_step[snapshot];
+		for (size_t i = state.snapshot_begin[snapshot]; i < state.snapshot_begin[snapshot + 1]; i++)
+		{
+			_lengths[state.snapshot_keys[i]] = state.snapshot_lengths[i];
+			_candidates.insert(state.snapshot_keys[i]);
+		}
+
+		state.snapshot_step.resize(snapshot + 1);
+		state.snapshot_begin.resize(snapshot + 2);
+		state.snapshot_keys.resize(state.snapshot_begin.back());
+		state.snapshot_lengths.resize(state.snapshot_begin.back());
+	}
+
+	//The next call often starts at the same step again, e.g. for the next rotation of the same rectangle
+	const size_t restart = state.valid;
+	for (; step < n; step++)
+	{
+		if ((step % _interval == 0 || step == restart)
+		    && (state.snapshot_step.empty() || state.snapshot_step.back() < step)
+		    && state.snapshot_keys.size() < _snapshot_budget)
+		{
+			take_snapshot(state, step);
+		}
+
+		const size_t pack_index = dim == dimension::x ? sp.positive_locus[step] : sp.positive_locus[n - 1 - step];
+		const size_t key = _negative_position[pack_index] + 1;
+
+		//The same as in sequence_pair::fast_pass
+		const pos position = _lengths[_candidates.predecessor(key)];
+		state.coordinates[pack_index] = position;
+
+		const pos length = position + extents[pack_index];
+		_lengths[key] = length;
+		_candidates.insert(key);
+
+		for (size_t next = _candidates.successor(key + 1);
+		     next != rank_set::npos && _lengths[next] < length;
+		     next = _candidates.successor(next + 1))
+		{
+			_candidates.erase(next);
+		}
+
+		if (length > limit)
+		{
+			//The snapshots up to this step are still right
+			state.valid = step;
 			return false;
 		}
 	}
 
+	//The lengths grow with the keys, so the last candidate has the longest chain
+	state.valid = n;
+	state.extent = _lengths[_candidates.predecessor(n)];
 	return true;
 }
+
+void incremental_sp_evaluator::take_snapshot(dimension_state & state, size_t step)
+{
+	_candidates.for_each([&](size_t key)
+	{
+		state.snapshot_keys.push_back(key);
+		state.snapshot_lengths.push_back(_lengths[key]);
+	});
+	state.snapshot_step.push_back(step);
+	state.snapshot_begin.push_back(state.snapshot_keys.size());
+}
@@ -7,18 +7,242 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <cmath>
 #include "common.h"
 #include "packing.h"
+#include "rank_set.h"
+#include "rect_store.h"
 
 class packing;
 
+/**
+ * One locus of a sequence pair: a permutation of the rectangle indices in a contiguous vector together with its
+ * inverse, so the position of a rectangle is known in O(1) and comparing two rectangles in the locus does not need a
+ * search. Every change keeps both arrays in sync.
+ */
+class locus
+{
+private:
+	std::vector<size_t> _order;
+	std::vector<size_t> _position;
+
+public:
+	typedef std::vector<size_t>::const_iterator const_iterator;
+	typedef std::vector<size_t>::const_reverse_iterator const_reverse_iterator;
+
+	/**
+	 * A contiguous part of a locus, valid until the locus changes.
+	 */
+	struct span
+	{
+		const size_t *first;
+		const size_t *last;
+
+		const size_t *begin() const { return first; }
+		const size_t *end() const { return last; }
+		size_t size() const { return (size_t)(last - first); }
+		size_t operator[](size_t i) const { return first[i]; }
+	};
+
+	locus() = default;
+
+	/**
+	 * Creates the locus (0, 1, ..., length - 1).
+	 * @param length The number of rectangles.
+	 */
+	explicit locus(size_t length);
+
+	/**
+	 * Creates a locus from a sequence of rectangle indices.
+	 * @param begin The first rectangle.
+	 * @param end Behind the last rectangle.
+	 */
+	template<class Iterator>
+	locus(Iterator begin, Iterator end) :
+		_order(begin, end)
+	{
+		update_positions(0, _order.size());
+	}
+
+	size_t size() const { return _order.size(); }
+	bool empty() const { return _order.empty(); }
+
+	const_iterator begin() const { return _order.begin(); }
+	const_iterator end() const { return _order.end(); }
+	const_reverse_iterator rbegin() const { return _order.rbegin(); }
+	const_reverse_iterator rend() const { return _order.rend(); }
+
+	/**
+	 * Returns the rectangle at a position.
+	 * @param position The position in the locus.
+	 * @return The index of the rectangle.
+	 */
+	size_t operator[](size_t position) const { return _order[position]; }
+
+	/**
+	 * Returns the position of a rectangle.
+	 * @param rect The index of the rectangle.
+	 * @return The position with (*this)[position] == rect.
+	 */
+	size_t position(size_t rect) const { return _position[rect]; }
+
+	/**
+	 * Checks whether the first rectangle comes before the second one.
+	 * @param first The index of a rectangle.
+	 * @param second The index of another rectangle.
+	 * @return position(first) < position(second)
+	 */
+	bool before(size_t first, size_t second) const { return _position[first] < _position[second]; }
+
+	/**
+	 * Returns the positions [first, last) of the locus.
+	 * @param first The first position.
+	 * @param last The position behind the span.
+	 * @return The rectangles at these positions.
+	 */
+	span slice(size_t first, size_t last) const { return span{_order.data() + first, _order.data() + last}; }
+
+	/**
+	 * Appends a rectangle which is not in the locus yet. The inverse grows to the largest index seen.
+	 * @param rect The index of the rectangle.
+	 */
+	void push_back(size_t rect);
+
+	/**
+	 * Puts a rectangle at a position. While this overwrites another rectangle, the locus is no permutation, it is one
+	 * again once every overwritten rectangle was put somewhere else.
+	 * @param position The position.
+	 * @param rect The index of the rectangle.
+	 */
+	void set(size_t position, size_t rect)
+	{
+		_order[position] = rect;
+		_position[rect] = position;
+	}
+
+	/**
+	 * Exchanges the positions of two rectangles in O(1).
+	 * @param first The index of a rectangle.
+	 * @param second The index of another rectangle.
+	 */
+	void swap(size_t first, size_t second);
+
+	/**
+	 * Moves a rectangle to another position, the rectangles in between move by one. This takes time linear in the
+	 * distance, the rectangles behind both positions are not touched.
+	 * @param rect The index of the rectangle.
+	 * @param position Its new position.
+	 */
+	void move(size_t rect, size_t position);
+
+	/**
+	 * Replaces the locus by the next permutation in lexicographic order, see std::next_permutation.
+	 * @return False if the locus was the last permutation and is the first one now.
+	 */
+	bool next_permutation();
+
+	/**
+	 * Replaces the locus by the next permutation in lexicographic order of the groups of its rectangles, so
+	 * rectangles of the same group are never exchanged with each other. To visit every order of the groups once, the
+	 * locus has to start sorted by groups.
+	 * @param group For every rectangle the number of its group, see packing::find_symmetries.
+	 * @return False if the locus was the last permutation and is sorted by groups now.
+	 */
+	bool next_permutation(const std::vector<size_t> &group);
+
+private:
+	/**
+	 * Recomputes _position for the rectangles at the positions [first, last).
+	 */
+	void update_positions(size_t first, size_t last);
+};
+
+/**
+ * The algorithms computing the coordinates of a sequence pair. Both compute the same weighted longest common
+ * subsequences, they only differ in the structure holding the candidates.
+ */
+enum class sp_evaluator
+{
+	// The candidates are kept in a std::map, this allocates a node for every rectangle
+	map,
+	// FAST-SP with the candidates in a rank_set over the positions in the negative locus, kept in an sp_scratch
+	fast
+};
+
+class incremental_sp_evaluator;
+
+/**
+ * Buffers for sequence_pair::evaluate. They grow to the largest packing seen and are reused by every evaluation, so
+ * keep one per thread for a whole search.
+ */
+struct sp_scratch
+{
+	// The candidate chains of FAST-SP, see sequence_pair::place_dimension_fast
+	rank_set candidates;
+	std::vector<pos> lengths;
+
+	// The coordinates computed by the last evaluation relative to the chip base, only complete if it fit
+	std::vector<pos> coordinates[2];
+
+	// The lengths of the longest chains right of and above every rectangle, see sequence_pair::evaluate_tails
+	std::vector<pos> tails[2];
+
+	/**
+	 * Prepares the buffers for a packing of the given size.
+	 */
+	void reset(size_t num_rects);
+};
+
+/**
+ * The result of sequence_pair::evaluate.
+ */
+struct sp_bounds
+{
+	// False if a rectangle exceeds the chip base, the other members are not set then
+	bool fits;
+
+	// The extents of the placement, measured from the base point of the chip base
+	pos width;
+	pos height;
+
+	// The area packing::calculate_area returns after applying the sequence pair
+	pos area;
+};
+
 class sequence_pair
 {
 private:
-	std::vector<pos> place_dimension(dimension dim, const packing & pack) const;
+	/**
+	 * Moves the rectangles to the given coordinates relative to the chip base, stops at the first rectangle which
+	 * does not fit into the chip base.
+	 */
+	static bool place_rects(packing &pack, const std::vector<pos> &x_coords, const std::vector<pos> &y_coords);
+
+	/**
+	 * The evaluators behind place_dimension(dim, pack, evaluator) with the dimension fixed at compile time.
+	 */
+	template<dimension dim>
+	std::vector<pos> place_dimension_map(const packing & pack) const;
+
+	template<dimension dim>
+	std::vector<pos> place_dimension_fast(const packing & pack, sp_scratch &scratch) const;
+
+	/**
+	 * One pass of FAST-SP, it stops as soon as a rectangle ends behind the limit. The reverse pass computes the
+	 * longest chains right of (or above) the rectangles instead.
+	 * @param extents The extents of the rectangles in this dimension.
+	 * @param limit The largest allowed coordinate of a right (or upper) border.
+	 * @param scratch The candidates, they have to be reset before.
+	 * @param coordinates Gets the coordinates.
+	 * @param extent Gets the largest border.
+	 * @return False if the pass was stopped.
+	 */
+	template<dimension dim, bool reverse>
+	bool fast_pass(const std::vector<pos> &extents, pos limit, sp_scratch &scratch, std::vector<pos> &coordinates,
+	               pos &extent) const;
 
 public:
-	std::list<size_t> positive_locus, negative_locus;
+	locus positive_locus, negative_locus;
 
 	sequence_pair () = default;
 
@@ -29,18 +253,181 @@ public:
 	explicit sequence_pair (size_t length):
             positive_locus(length),
             negative_locus(length)
-    {
-        std::iota(positive_locus.begin(), positive_locus.end(), 0);
-        std::iota(negative_locus.begin(), negative_locus.end(), 0);
-    }
+    {}
+
+	/**
+	 * Computes the coordinates of all rectangles in one dimension relative to the chip base, i.e. the length of the
+	 * longest chain of rectangles left of (or below) every rectangle.
+	 * @param dim The dimension.
+	 * @param pack The packing, only the extents of its rectangles are used.
+	 * @param evaluator The algorithm to use, the result is the same for all of them.
+	 * @return The coordinate of every rectangle.
+	 */
+	std::vector<pos> place_dimension(dimension dim, const packing & pack,
+	                                 sp_evaluator evaluator = sp_evaluator::fast) const;
+
+	/**
+	 * The same as place_dimension with sp_evaluator::fast, but with the given buffers, so repeated evaluations do
+	 * not allocate them again.
+	 */
+	std::vector<pos> place_dimension(dimension dim, const packing & pack, sp_scratch &scratch) const;
+
+	/**
+	 * Computes the bounds of the placement of this sequence pair without touching the packing. The rectangles are
+	 * evaluated with their extents in the given orientations, the evaluation stops as soon as one of them does not
+	 * fit into the chip base.
+	 * @param widths The widths of the rectangles in the orientations to evaluate.
+	 * @param heights The heights of the rectangles in the orientations to evaluate.
+	 * @param chip_base The chip base.
+	 * @param scratch The buffers to use, they contain the coordinates afterwards, see place_evaluated.
+	 * @return The bounds of the placement.
+	 */
+	sp_bounds evaluate(const std::vector<pos> &widths, const std::vector<pos> &heights, const rectangle &chip_base,
+	                   sp_scratch &scratch) const;
+
+	/**
+	 * Computes the mirror image of evaluate: the length of the longest chain of rectangles right of and above every
+	 * rectangle, which is how far it has to stay from the right and upper border of the chip base. Together with the
+	 * coordinates of evaluate this gives the range of every rectangle in the placements of this sequence pair.
+	 * @param widths The widths of the rectangles in the orientations to evaluate.
+	 * @param heights The heights of the rectangles in the orientations to evaluate.
+	 * @param scratch The buffers to use, the lengths are in tails afterwards. The coordinates are kept.
+	 */
+	void evaluate_tails(const std::vector<pos> &widths, const std::vector<pos> &heights, sp_scratch &scratch) const;
+
+	/**
+	 * The same as evaluate with the current orientations of the rectangles of a packing.
+	 */
+	sp_bounds evaluate(const packing &pack, sp_scratch &scratch) const;
+
+	/**
+	 * Moves the rectangles to the coordinates of the last evaluation which fit, e.g. when it was a new best one.
+	 * @param pack The packing which was evaluated.
+	 * @param scratch The buffers given to evaluate.
+	 */
+	static void place_evaluated(packing &pack, const sp_scratch &scratch);
 
 	/**
 	 * Places rectangles according to this sequence pair. The placment will might be incomplete if
 	 * it is impossible to place the rectangles this way in the given area.
 	 * @param pack The packing which will be modified.
+	 * @param evaluator The algorithm computing the coordinates.
+	 * @return True if this was succesful, false if rectangles were out of bounds.
+	 */
+	bool apply_to(packing &pack, sp_evaluator evaluator = sp_evaluator::fast) const;
+
+	/**
+	 * The same as apply_to(pack), but the coordinates are computed by an incremental evaluator, which is a lot
+	 * faster if this sequence pair and the rectangles differ only a little from the last call with this evaluator.
+	 * @param pack The packing which will be modified.
+	 * @param evaluator The evaluator, it remembers this sequence pair.
 	 * @return True if this was succesful, false if rectangles were out of bounds.
 	 */
-	bool apply_to(packing &pack) const;
+	bool apply_to(packing &pack, incremental_sp_evaluator &evaluator) const;
+};
+
+/**
+ * Evaluates a series of similar sequence pairs, e.g. the ones of placement_iterator in k-local mode. The evaluation is
+ * the FAST-SP one, which goes through the positive locus and keeps the candidate chains of the steps so far. The
+ * candidates after every few steps are kept as snapshots. The next call compares the sequence pair and the extents
+ * of the rectangles with the previous ones, continues from the last snapshot before the first step which sees a
+ * difference and only recomputes the coordinates from there on. The coordinates are the same as the ones of
+ * sequence_pair::place_dimension, the bounds the same as the ones of sequence_pair::evaluate.
+ */
+class incremental_sp_evaluator
+{
+private:
+	struct dimension_state
+	{
+		std::vector<pos> coordinates;
+
+		// The steps before this one are up to date, their coordinates and the snapshots taken before them
+		size_t valid = 0;
+
+		// The largest border, only set if all steps are valid
+		pos extent = 0;
+
+		// Snapshot j was taken before step snapshot_step[j], its candidates are at the indices
+		// [snapshot_begin[j], snapshot_begin[j + 1]) of snapshot_keys and snapshot_lengths
+		std::vector<size_t> snapshot_step;
+		std::vector<size_t> snapshot_begin;
+		std::vector<size_t> snapshot_keys;
+		std::vector<pos> snapshot_lengths;
+	};
+
+	dimension_state _states[2];
+
+	// The positions in the sequence pair and the extents of the rectangles seen by the last call
+	std::vector<size_t> _positive_position;
+	std::vector<size_t> _negative_position;
+	std::vector<pos> _extents[2];
+
+	rank_set _candidates;
+	std::vector<pos> _lengths;
+
+	// Snapshots are taken every _interval steps while a dimension has less than _snapshot_budget stored candidates
+	size_t _interval = 1;
+	size_t _snapshot_budget = 0;
+
+	/**
+	 * Forgets the last call and remembers the given sequence pair and extents, if their size changed.
+	 * @return True if nothing could be reused.
+	 */
+	bool reset(const sequence_pair &sp, const rect_store &store);
+
+	/**
+	 * Compares a rectangle with the last call and invalidates the steps from the first one it changes on.
+	 */
+	void compare(const sequence_pair &sp, const rect_store &store, size_t rect);
+
+	/**
+	 * Computes the coordinates of one dimension from the first step which is not valid on, and stops like
+	 * sequence_pair::evaluate as soon as a rectangle ends behind the limit. In x direction, step s places the
+	 * rectangle at position s of the positive locus, in y direction the one at position n - 1 - s.
+	 * @return False if the evaluation was stopped.
+	 */
+	template<dimension dim>
+	bool evaluate_from_valid(const sequence_pair &sp, const std::vector<pos> &extents, pos limit);
+
+	/**
+	 * Brings both dimensions up to date and computes the bounds.
+	 */
+	sp_bounds evaluate_invalid(const sequence_pair &sp, const packing &pack);
+
+	/**
+	 * Stores the current candidates as snapshot before the given step.
+	 */
+	void take_snapshot(dimension_state &state, size_t step);
+
+public:
+	/**
+	 * Computes the coordinates for a sequence pair, reusing what did not change since the last call.
+	 * @param sp The sequence pair.
+	 * @param pack The packing, only the extents of its rectangles and the chip base are used.
+	 * @return The same bounds as sequence_pair::evaluate.
+	 */
+	sp_bounds evaluate(const sequence_pair &sp, const packing &pack);
+
+	/**
+	 * The same as evaluate(sp, pack), but only the given rectangles are compared with the last call, so the call
+	 * does not need to look at the whole sequence pair.
+	 * @param sp The sequence pair.
+	 * @param pack The packing, only the extents of its rectangles and the chip base are used.
+	 * @param changed All rectangles whose positions in the loci or extents may have changed since the last call, see
+	 * placement_iterator::get_changed_rects.
+	 * @return The same bounds as sequence_pair::evaluate.
+	 */
+	sp_bounds evaluate(const sequence_pair &sp, const packing &pack, const std::vector<size_t> &changed);
+
+	/**
+	 * Returns the coordinates computed by the last call of evaluate, they are only complete if it fit.
+	 * @param dim The dimension.
+	 * @return The coordinates relative to the chip base.
+	 */
+	const std::vector<pos> &get_coordinates(dimension dim) const
+	{
+		return _states[(int)dim].coordinates;
+	}
 };
 
 std::ostream &operator<<(std::ostream &out, const sequence_pair &);
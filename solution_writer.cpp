@@ -0,0 +1,137 @@
+#include "solution_writer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Six numbers with at most 11 characters and a separator each
+static constexpr size_t MAX_LINE_LENGTH = 6 * 12;
+
+// We write in pieces of this size, so we do not hand gigantic buffers to a single write
+static constexpr size_t WRITE_BLOCK_SIZE = 1 << 22;
+
+solution_writer::~solution_writer()
+{
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+char *solution_writer::append(char *out, pos value, char separator)
+{
+    char digits[12];
+    size_t length = 0;
+
+    // Go through unsigned, so the negation of the smallest int does not overflow
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int) value : (unsigned int) value;
+    do
+    {
+        digits[length++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        *out++ = '-';
+    }
+
+    while (length > 0)
+    {
+        *out++ = digits[--length];
+    }
+    *out++ = separator;
+
+    return out;
+}
+
+void solution_writer::write(const packing &pack, bool background)
+{
+    wait();
+
+    _buffer.resize(pack.get_num_rects() * MAX_LINE_LENGTH);
+    char *out = _buffer.data();
+
+    for (size_t i = 0; i < pack.get_num_rects(); ++i)
+    {
+        const rectangle &rect = pack.get_rect((int) i);
+        assert(rect.placed());
+
+        for (dimension dim : all_dimensions)
+        {
+            out = append(out, rect.get_pos(dim), ' ');
+            out = append(out, rect.get_max(dim), ' ');
+        }
+
+        out = append(out, rect.flipped, ' ');
+        out = append(out, (pos) rect.rot, '\n');
+    }
+
+    _buffer.resize((size_t) (out - _buffer.data()));
+
+    if (background)
+    {
+        _thread = std::thread([this]()
+        {
+            try
+            {
+                write_buffer();
+            }
+            catch (...)
+            {
+                _error = std::current_exception();
+            }
+        });
+    }
+    else
+    {
+        write_buffer();
+    }
+}
+
+void solution_writer::write_buffer()
+{
+    int fd = open(_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open " + _filename + " for writing.");
+    }
+
+    size_t written = 0;
+    while (written < _buffer.size())
+    {
+        ssize_t result = ::write(fd, _buffer.data() + written, std::min(WRITE_BLOCK_SIZE, _buffer.size() - written));
+        if (result < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            close(fd);
+            throw std::runtime_error("Could not write to " + _filename + ": " + std::strerror(errno));
+        }
+        written += (size_t) result;
+    }
+
+    if (close(fd) != 0)
+    {
+        throw std::runtime_error("Could not write to " + _filename + ": " + std::strerror(errno));
+    }
+}
+
+void solution_writer::wait()
+{
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+
+    if (_error)
+    {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef SOLUTION_WRITER_H
+#define SOLUTION_WRITER_H
+
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "packing.h"
+
+/**
+ * Writes solutions in the same format as operator<< of packing, but a lot faster: All rectangles are formatted into
+ * one buffer which is then written with few system calls. The writing can happen on a background thread, so the
+ * caller does not have to wait for the disk.
+ */
+class solution_writer
+{
+private:
+    std::string _filename;
+    std::vector<char> _buffer;
+    std::thread _thread;
+    std::exception_ptr _error;
+
+    /**
+     * Formats a number followed by a separator. There has to be space for 12 characters.
+     * @param out The position where the number is written to.
+     * @param value The number to write.
+     * @param separator The character which is written after the number.
+     * @return The position behind the separator.
+     */
+    static char *append(char *out, pos value, char separator);
+
+    /**
+     * Writes _buffer to _filename.
+     */
+    void write_buffer();
+
+public:
+    explicit solution_writer(std::string filename) :
+            _filename(std::move(filename))
+    {}
+
+    solution_writer(const solution_writer &) = delete;
+
+    solution_writer &operator=(const solution_writer &) = delete;
+
+    /**
+     * Waits for a write in the background to finish. Errors of the background thread are lost, call wait() to
+     * receive them.
+     */
+    ~solution_writer();
+
+    /**
+     * Writes all rectangles of the packing. The packing is formatted before this returns, so it may be changed
+     * afterwards even if the file is written in the background.
+     * @param pack The packing to write, all rectangles have to be placed.
+     * @param background If true, the file is written on another thread and the method returns immediately.
+     */
+    void write(const packing &pack, bool background = false);
+
+    /**
+     * Waits until the file is written completely.
+     * Throws the error of the background thread if there was one.
+     */
+    void wait();
+};
+
+#endif // SOLUTION_WRITER_H